@@ -4,9 +4,39 @@
 
 #pragma once
 
+#include <cstddef>
+
 // cli draw
 inline constexpr char CHARS_LUM[] = " .:-=+*#%@";
 inline constexpr float CHAR_ASPECT_RATIO = 2.0f;
+inline constexpr size_t LUMINANCE_LEVELS = 256;     // quantization steps of light cosine
+
+// placement
+inline constexpr float OBJECT_SIZE = 3.0f;      // largest extent of placed model, makes model >= 0.5 screen size
+
+// load diagnostics
+inline constexpr size_t DIAGNOSTIC_LINES = 5;   // line numbers listed per warning category
+
+// ply
+inline constexpr size_t PLY_COLOR_LEVELS = 4;   // quantization steps per channel of vertex colors mapped to materials
+
+// welding
+inline constexpr float WELD_EPSILON = 1e-5f;    // relative to unit cube
+
+// meshlets
+inline constexpr unsigned int MESHLET_MAX_FACES = 64;
+inline constexpr float MESHLET_CONE_COS = 0.8f;    // minimal cosine between face normal and cluster axis
+
+// vertex cache
+inline constexpr size_t VERTEX_CACHE_SIZE = 16;       // fifo size for acmr metric
+inline constexpr size_t CACHE_OPTIMIZE_MAX_FACES = 250000;  // larger models keep meshlet order, pass would dominate startup
+
+// level of detail
+inline constexpr size_t LOD_MAX_LEVELS = 8;
+inline constexpr size_t LOD_MIN_FACES = 1000;          // no coarser level below this face count
+inline constexpr float LOD_FACES_PER_PIXEL = 4.0f;     // faces kept per covered screen cell
+inline constexpr float LOD_BORDER_WEIGHT = 1000.0f;    // weight of boundary and material border planes
+inline constexpr size_t LOD_STOP_INTERVAL = 65536;     // faces or edges between checks of cancelled build
 
 // view
 inline constexpr float ANGLE_STEP = 5.0f;
@@ -18,3 +48,29 @@ inline constexpr float ZOOM_MAX = 5.00f;
 // animation
 inline constexpr float FRAME_DURATION = 1.0f / 60.0f; // 60 fps
 inline constexpr float ANIMATION_STEP = 30.0f;
+inline constexpr float TURNTABLE_STEP = 1.0f;      // deg between pre-rendered frames
+
+// bounding volume hierarchy for ray casting
+inline constexpr unsigned int BVH_BINS = 16;            // surface area heuristic candidate splits per axis
+inline constexpr unsigned int BVH_LEAF_FACES = 4;       // nodes with this few faces are never split
+inline constexpr unsigned int BVH_MAX_LEAF_FACES = 16;  // larger nodes are split even when not profitable
+inline constexpr int BVH_MAX_DEPTH = 64;
+
+// ray casting backend
+inline constexpr float RAYCAST_FACES_PER_PIXEL = 16.0f; // automatic backend casts rays above this density
+inline constexpr size_t RAYCAST_MIN_FACES = 1000000;    // automatic backend builds hierarchy from this size
+
+// coarse depth tiles in screen cells, roughly square on screen
+inline constexpr unsigned int DEPTH_TILE_X = 8;
+inline constexpr unsigned int DEPTH_TILE_Y = 4;
+
+// frame cache
+inline constexpr int FRAME_CACHE_MB = 16;
+
+// input latency histogram
+inline constexpr float LATENCY_RESOLUTION = 0.1f;   // ms per bucket
+inline constexpr size_t LATENCY_BUCKETS = 10000;    // covers 1 s
+
+// benchmark
+inline constexpr unsigned int BENCH_COLS = 200;
+inline constexpr unsigned int BENCH_ROWS = 60;
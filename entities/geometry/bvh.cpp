@@ -0,0 +1,389 @@
+/*
+ * bvh.cpp
+ */
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "object.h"
+#include "config.h"
+
+// bounds and centroid of single face
+class FaceBounds {
+public:
+    Vec3 min, max;
+    Vec3 centroid;
+};
+
+static float axis(const Vec3 &v, const int a)
+{
+    return a == 0 ? v.x : (a == 1 ? v.y : v.z);
+}
+
+static void grow(Vec3 &min, Vec3 &max, const Vec3 &p)
+{
+    min = Vec3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+    max = Vec3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+}
+
+static float half_area(const Vec3 &min, const Vec3 &max)
+{
+    const float ex = max.x - min.x;
+    const float ey = max.y - min.y;
+    const float ez = max.z - min.z;
+    return ex * ey + ey * ez + ez * ex;
+}
+
+// builds subtree over faces[begin, end) and returns its node index
+static unsigned int build_node(std::vector<BvhNode> &nodes, std::vector<unsigned int> &faces, const std::vector<FaceBounds> &bounds, const unsigned int begin, const unsigned int end, const int depth)
+{
+    constexpr float inf = std::numeric_limits<float>::max();
+
+    Vec3 min(inf, inf, inf), max(-inf, -inf, -inf);
+    Vec3 cmin(inf, inf, inf), cmax(-inf, -inf, -inf);
+
+    for (unsigned int i = begin; i < end; i++)
+    {
+        const FaceBounds &b = bounds[faces[i]];
+        grow(min, max, b.min);
+        grow(min, max, b.max);
+        grow(cmin, cmax, b.centroid);
+    }
+
+    const auto index = static_cast<unsigned int>(nodes.size());
+    nodes.push_back(BvhNode{min, max, begin, end - begin});
+
+    const unsigned int count = end - begin;
+    if (count <= BVH_LEAF_FACES || depth >= BVH_MAX_DEPTH)
+    {
+        return index;
+    }
+
+    // split along longest centroid extent
+    const Vec3 extent = cmax - cmin;
+    const int a = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    const float lo = axis(cmin, a);
+    const float span = axis(extent, a);
+
+    unsigned int mid = begin;
+
+    if (span > 0.0f)
+    {
+        // binned surface area heuristic
+        std::array<unsigned int, BVH_BINS> bin_count{};
+        std::array<Vec3, BVH_BINS> bin_min, bin_max;
+        bin_min.fill(Vec3(inf, inf, inf));
+        bin_max.fill(Vec3(-inf, -inf, -inf));
+
+        auto bin_of = [&](const unsigned int face) {
+            const auto b = static_cast<int>((axis(bounds[face].centroid, a) - lo) / span * static_cast<float>(BVH_BINS));
+            return std::clamp(b, 0, static_cast<int>(BVH_BINS) - 1);
+        };
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+            const int b = bin_of(faces[i]);
+            bin_count[b]++;
+            grow(bin_min[b], bin_max[b], bounds[faces[i]].min);
+            grow(bin_min[b], bin_max[b], bounds[faces[i]].max);
+        }
+
+        // right side costs accumulated from last bin
+        std::array<float, BVH_BINS> right_cost{};
+        Vec3 rmin(inf, inf, inf), rmax(-inf, -inf, -inf);
+        unsigned int rcount = 0;
+
+        for (int b = BVH_BINS - 1; b > 0; b--)
+        {
+            grow(rmin, rmax, bin_min[b]);
+            grow(rmin, rmax, bin_max[b]);
+            rcount += bin_count[b];
+            right_cost[b] = rcount > 0 ? static_cast<float>(rcount) * half_area(rmin, rmax) : 0.0f;
+        }
+
+        Vec3 lmin(inf, inf, inf), lmax(-inf, -inf, -inf);
+        unsigned int lcount = 0;
+
+        float best_cost = static_cast<float>(count) * half_area(min, max);  // cost of leaf
+        int best_split = -1;
+
+        for (int b = 1; b < static_cast<int>(BVH_BINS); b++)
+        {
+            grow(lmin, lmax, bin_min[b - 1]);
+            grow(lmin, lmax, bin_max[b - 1]);
+            lcount += bin_count[b - 1];
+
+            if (lcount == 0 || lcount == count)
+            {
+                continue;
+            }
+
+            if (const float cost = static_cast<float>(lcount) * half_area(lmin, lmax) + right_cost[b]; cost < best_cost)
+            {
+                best_cost = cost;
+                best_split = b;
+            }
+        }
+
+        if (best_split < 0 && count <= BVH_MAX_LEAF_FACES)
+        {
+            return index;
+        }
+
+        if (best_split >= 0)
+        {
+            mid = static_cast<unsigned int>(std::partition(faces.begin() + begin, faces.begin() + end,
+                [&](const unsigned int f) { return bin_of(f) < best_split; }) - faces.begin());
+        }
+    }
+
+    // coincident centroids or no profitable split, halve by count
+    if (mid == begin || mid == end)
+    {
+        mid = begin + count / 2;
+        std::nth_element(faces.begin() + begin, faces.begin() + mid, faces.begin() + end,
+            [&](const unsigned int f1, const unsigned int f2) { return axis(bounds[f1].centroid, a) < axis(bounds[f2].centroid, a); });
+    }
+
+    nodes[index].count = 0;
+    build_node(nodes, faces, bounds, begin, mid, depth + 1);
+    nodes[index].first = build_node(nodes, faces, bounds, mid, end, depth + 1);
+
+    return index;
+}
+
+void Bvh::build(const Object &obj)
+{
+    nodes.clear();
+    faces.resize(obj.faces.size());
+
+    if (obj.faces.empty())
+    {
+        return;
+    }
+
+    std::vector<FaceBounds> bounds(obj.faces.size());
+
+    for (size_t i = 0; i < obj.faces.size(); i++)
+    {
+        const auto &idx = obj.faces[i].indices;
+        const Vec3 &v1 = obj.vertices[idx[0]];
+        const Vec3 &v2 = obj.vertices[idx[1]];
+        const Vec3 &v3 = obj.vertices[idx[2]];
+
+        FaceBounds &b = bounds[i];
+        b.min = v1;
+        b.max = v1;
+        grow(b.min, b.max, v2);
+        grow(b.min, b.max, v3);
+        b.centroid = Vec3((v1.x + v2.x + v3.x) / 3.0f, (v1.y + v2.y + v3.y) / 3.0f, (v1.z + v2.z + v3.z) / 3.0f);
+
+        faces[i] = static_cast<unsigned int>(i);
+    }
+
+    nodes.reserve(2 * obj.faces.size() / BVH_LEAF_FACES + 1);
+    build_node(nodes, faces, bounds, 0, static_cast<unsigned int>(faces.size()), 0);
+    nodes.shrink_to_fit();
+}
+
+// entry and exit of line through box, inverse direction components may be infinite
+static bool slab(const BvhNode &node, const Vec3 &origin, const Vec3 &inv, float &t_near)
+{
+    const float tx1 = (node.min.x - origin.x) * inv.x, tx2 = (node.max.x - origin.x) * inv.x;
+    const float ty1 = (node.min.y - origin.y) * inv.y, ty2 = (node.max.y - origin.y) * inv.y;
+    const float tz1 = (node.min.z - origin.z) * inv.z, tz2 = (node.max.z - origin.z) * inv.z;
+
+    t_near = std::max({std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2)});
+    const float t_far = std::min({std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2)});
+
+    return t_near <= t_far;
+}
+
+bool Bvh::intersect(const Object &obj, const Vec3 &origin, const Vec3 &dir, float &t, unsigned int &face) const
+{
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    // tiny components avoid nan from zero times infinity on box planes
+    auto inverse = [](const float d) { return 1.0f / (std::fabs(d) > 1e-12f ? d : 1e-12f); };
+    const Vec3 inv(inverse(dir.x), inverse(dir.y), inverse(dir.z));
+
+    float best = std::numeric_limits<float>::max();
+    bool hit = false;
+
+    std::array<unsigned int, BVH_MAX_DEPTH * 2 + 2> stack;
+    size_t top = 0;
+
+    if (float t_root; !slab(nodes[0], origin, inv, t_root))
+    {
+        return false;
+    }
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const unsigned int current = stack[--top];
+        const BvhNode &node = nodes[current];
+
+        if (node.count > 0)
+        {
+            for (unsigned int i = node.first; i < node.first + node.count; i++)
+            {
+                const unsigned int f = faces[i];
+
+                // back-facing triangles are never visible
+                const Vec3 &n = obj.normals[f];
+                if (n.x * dir.x + n.y * dir.y + n.z * dir.z >= 0.0f)
+                {
+                    continue;
+                }
+
+                // moller-trumbore intersection, scalar form keeps inner loop free of calls
+                const auto &idx = obj.faces[f].indices;
+                const Vec3 &p1 = obj.vertices[idx[0]];
+                const Vec3 &p2 = obj.vertices[idx[1]];
+                const Vec3 &p3 = obj.vertices[idx[2]];
+
+                const float e1x = p2.x - p1.x, e1y = p2.y - p1.y, e1z = p2.z - p1.z;
+                const float e2x = p3.x - p1.x, e2y = p3.y - p1.y, e2z = p3.z - p1.z;
+
+                const float px = dir.y * e2z - dir.z * e2y;
+                const float py = dir.z * e2x - dir.x * e2z;
+                const float pz = dir.x * e2y - dir.y * e2x;
+
+                const float det = e1x * px + e1y * py + e1z * pz;
+                if (std::fabs(det) < 1e-12f)
+                {
+                    continue;
+                }
+
+                const float inv_det = 1.0f / det;
+                const float sx = origin.x - p1.x, sy = origin.y - p1.y, sz = origin.z - p1.z;
+
+                const float u = (sx * px + sy * py + sz * pz) * inv_det;
+                if (u < 0.0f || u > 1.0f)
+                {
+                    continue;
+                }
+
+                const float qx = sy * e1z - sz * e1y;
+                const float qy = sz * e1x - sx * e1z;
+                const float qz = sx * e1y - sy * e1x;
+
+                const float v = (dir.x * qx + dir.y * qy + dir.z * qz) * inv_det;
+                if (v < 0.0f || u + v > 1.0f)
+                {
+                    continue;
+                }
+
+                if (const float d = (e2x * qx + e2y * qy + e2z * qz) * inv_det; d < best)
+                {
+                    best = d;
+                    face = f;
+                    hit = true;
+                }
+            }
+
+            continue;
+        }
+
+        // visit nearer child first, skip children beyond current hit
+        unsigned int left = current + 1;
+        unsigned int right = node.first;
+
+        float t_left, t_right;
+        const bool hit_left = slab(nodes[left], origin, inv, t_left) && t_left < best;
+        const bool hit_right = slab(nodes[right], origin, inv, t_right) && t_right < best;
+
+        if (hit_left && hit_right)
+        {
+            if (t_right < t_left)
+            {
+                std::swap(left, right);
+            }
+
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+        else if (hit_left)
+        {
+            stack[top++] = left;
+        }
+        else if (hit_right)
+        {
+            stack[top++] = right;
+        }
+    }
+
+    t = best;
+    return hit;
+}
+
+std::pair<float, float> Bvh::extent(const Object &obj, const Vec3 &dir) const
+{
+    // largest dot(sign * dir, v), subtrees that cannot exceed current extreme are skipped
+    auto extreme = [&](const float sign) {
+        const Vec3 d = dir * sign;
+        float best = -std::numeric_limits<float>::max();
+
+        auto box_max = [&d](const BvhNode &node) {
+            return (d.x > 0.0f ? node.max.x : node.min.x) * d.x
+                 + (d.y > 0.0f ? node.max.y : node.min.y) * d.y
+                 + (d.z > 0.0f ? node.max.z : node.min.z) * d.z;
+        };
+
+        std::array<unsigned int, BVH_MAX_DEPTH * 2 + 2> stack;
+        size_t top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+            const unsigned int current = stack[--top];
+            const BvhNode &node = nodes[current];
+
+            if (box_max(node) <= best)
+            {
+                continue;
+            }
+
+            if (node.count > 0)
+            {
+                for (unsigned int i = node.first; i < node.first + node.count; i++)
+                {
+                    for (const unsigned int idx : obj.faces[faces[i]].indices)
+                    {
+                        best = std::max(best, Vec3::dot(d, obj.vertices[idx]));
+                    }
+                }
+
+                continue;
+            }
+
+            // more promising child on top
+            unsigned int left = current + 1;
+            unsigned int right = node.first;
+
+            if (box_max(nodes[left]) > box_max(nodes[right]))
+            {
+                std::swap(left, right);
+            }
+
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+
+        return best * sign;
+    };
+
+    if (nodes.empty())
+    {
+        return {0.0f, 0.0f};
+    }
+
+    return {extreme(-1.0f), extreme(1.0f)};
+}
@@ -0,0 +1,36 @@
+/*
+ * bvh.h
+ */
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "utils/mathematics.h"
+
+class Object;
+
+// axis aligned box node, children of inner node are stored depth first
+class BvhNode {
+public:
+    Vec3 min, max;          // bounds of faces below node
+    unsigned int first;     // first entry in face list for leaf, right child for inner node
+    unsigned int count;     // number of faces for leaf, 0 for inner node with left child following node
+};
+
+// bounding volume hierarchy over object faces, split by surface area heuristic
+class Bvh {
+public:
+    std::vector<BvhNode> nodes;
+    std::vector<unsigned int> faces;    // face indices in leaf order
+
+    void build(const Object &obj);      // object normals must be computed
+    [[nodiscard]] bool empty() const { return nodes.empty(); }
+
+    // nearest face facing ray along line through origin, t may be negative, returns false without hit
+    bool intersect(const Object &obj, const Vec3 &origin, const Vec3 &dir, float &t, unsigned int &face) const;
+
+    // min and max of dot(dir, v) over vertices of faces
+    [[nodiscard]] std::pair<float, float> extent(const Object &obj, const Vec3 &dir) const;
+};
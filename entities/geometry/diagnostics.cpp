@@ -0,0 +1,75 @@
+/*
+ * diagnostics.cpp
+ */
+
+#include "diagnostics.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+static const char *issue_name(const LoadIssue issue)
+{
+    switch (issue)
+    {
+        case LoadIssue::InvalidVertex:          return "invalid vertex format";
+        case LoadIssue::InvalidFaceToken:       return "invalid face token";
+        case LoadIssue::IndexOutOfRange:        return "vertex index out of range";
+        case LoadIssue::InvalidFaceVertex:      return "face uses invalid vertex";
+        case LoadIssue::ShortFace:              return "face contains less than 3 indexes";
+        case LoadIssue::TriangulationFailed:    return "triangularize failed";
+        case LoadIssue::UnknownMaterial:        return "unknown material";
+        case LoadIssue::InvalidFacet:           return "facet without 3 vertices";
+        default:                                return "unknown issue";
+    }
+}
+
+bool Diagnostics::report(const LoadIssue issue, const size_t line)
+{
+    if (mode == DiagnosticMode::Strict)
+    {
+        std::cerr << "error: " << issue_name(issue) << " at line " << line << std::endl;
+        return false;
+    }
+
+    const auto k = static_cast<size_t>(issue);
+    if (counts[k] < DIAGNOSTIC_LINES)
+    {
+        lines[k][counts[k]] = line;
+    }
+    counts[k]++;
+
+    return true;
+}
+
+void Diagnostics::print_summary() const
+{
+    if (mode == DiagnosticMode::Silent || total() == 0)
+    {
+        return;
+    }
+
+    for (size_t k = 0; k < CATEGORIES; k++)
+    {
+        if (counts[k] == 0)
+        {
+            continue;
+        }
+
+        std::cerr << "warning: " << issue_name(static_cast<LoadIssue>(k)) << " on " << counts[k] << (counts[k] == 1 ? " line" : " lines") << ", first at";
+
+        for (size_t i = 0; i < std::min(counts[k], DIAGNOSTIC_LINES); i++)
+        {
+            std::cerr << (i ? ", " : " ") << lines[k][i];
+        }
+
+        std::cerr << (counts[k] > DIAGNOSTIC_LINES ? ", ...\n" : "\n");
+    }
+
+    std::cerr.flush();
+}
+
+size_t Diagnostics::total() const
+{
+    return std::accumulate(counts.begin(), counts.end(), size_t{0});
+}
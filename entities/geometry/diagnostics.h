@@ -0,0 +1,48 @@
+/*
+ * diagnostics.h
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "config.h"
+
+// reaction to malformed lines of loaded file
+enum class DiagnosticMode {
+    Normal,     // skip line, print summary after load
+    Strict,     // stop load at first malformed line
+    Silent      // skip line, print nothing
+};
+
+// categories of malformed lines
+enum class LoadIssue {
+    InvalidVertex,
+    InvalidFaceToken,
+    IndexOutOfRange,
+    InvalidFaceVertex,
+    ShortFace,
+    TriangulationFailed,
+    UnknownMaterial,
+    InvalidFacet,
+    Count
+};
+
+// load warnings counted per category with line numbers of first occurrences
+class Diagnostics {
+public:
+    explicit Diagnostics(const DiagnosticMode mode) : mode(mode) {}
+
+    bool report(LoadIssue issue, size_t line);  // returns false when load must stop
+    void print_summary() const;                 // one line per reported category
+
+    [[nodiscard]] size_t total() const;
+
+private:
+    static constexpr size_t CATEGORIES = static_cast<size_t>(LoadIssue::Count);
+
+    DiagnosticMode mode;
+    std::array<size_t, CATEGORIES> counts{};
+    std::array<std::array<size_t, DIAGNOSTIC_LINES>, CATEGORIES> lines{};
+};
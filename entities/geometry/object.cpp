@@ -4,6 +4,13 @@
 
 #include "object.h"
 
+#include "ply.h"
+#include "simplify.h"
+#include "stl.h"
+#include "config.h"
+#include "utils/mapped_file.h"
+#include "utils/parallel.h"
+
 // helper functions
 
 // from obj index to vector index
@@ -11,38 +18,126 @@ static int relative_index(const int idx, int total_vertices)
 {
     if (idx == 0 || idx < -total_vertices || idx > total_vertices)
     {
-        std::cerr << "warning: invalid vertex index " << idx << std::endl;
         return -1;
     }
 
     return idx < 0 ? total_vertices + idx : idx - 1;
 }
 
-// clean string
-static void strip_line(std::string &line)
+// vertex and triangle counts of obj text, polygon of n corners makes n - 2 triangles
+static void count_elements(const std::string_view text, size_t &vertex_count, size_t &face_count)
+{
+    vertex_count = 0;
+    face_count = 0;
+
+    const char *p = text.data();
+    const char *const end = p + text.size();
+
+    while (p < end)
+    {
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!eol)
+        {
+            eol = end;
+        }
+
+        while (p < eol && (*p == ' ' || *p == '\t'))
+        {
+            p++;
+        }
+
+        if (eol - p > 1 && (p[1] == ' ' || p[1] == '\t'))
+        {
+            if (p[0] == 'v')
+            {
+                vertex_count++;
+            }
+            else if (p[0] == 'f')
+            {
+                size_t corners = 0;
+                bool gap = true;
+                for (const char *c = p + 1; c < eol; c++)
+                {
+                    const bool space = *c == ' ' || *c == '\t' || *c == '\r';
+                    corners += gap && !space;
+                    gap = space;
+                }
+
+                face_count += corners > 2 ? corners - 2 : 0;
+            }
+        }
+
+        p = eol + 1;
+    }
+}
+
+// unit normal of face, zero for degenerate face
+static Vec3 face_normal(const Face &f, const std::vector<Vec3> &vertices)
 {
-    std::erase_if(line, [](const char c) { return c == '\r' || c == '\n'; });
-    std::ranges::replace(line, '\t', ' ');
+    const Vec3 &v1 = vertices[f.indices[0]];
+    const Vec3 &v2 = vertices[f.indices[1]];
+    const Vec3 &v3 = vertices[f.indices[2]];
+
+    return Vec3::cross(v2 - v1, v3 - v1).normalize();
 }
 
-// check open file
-static std::optional<std::ifstream> open_file(const std::string &filename)
+// bounding sphere and normal cone of faces in range
+static void meshlet_bounds(Meshlet &m, const std::vector<Face> &faces, const std::vector<Vec3> &normals, const std::vector<Vec3> &vertices)
 {
-    std::ifstream in(filename, std::ios::in | std::ios::binary);
-    if (!in.is_open())
+    Vec3 vmin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    Vec3 vmax = -vmin;
+    Vec3 axis;
+
+    for (unsigned int i = m.first; i < m.first + m.count; i++)
     {
-        std::cerr << "error: can't open file " << filename << std::endl;
-        return std::nullopt;
+        for (const auto idx : faces[i].indices)
+        {
+            const Vec3 &v = vertices[idx];
+            vmin = Vec3(std::min(vmin.x, v.x), std::min(vmin.y, v.y), std::min(vmin.z, v.z));
+            vmax = Vec3(std::max(vmax.x, v.x), std::max(vmax.y, v.y), std::max(vmax.z, v.z));
+        }
+
+        axis += normals[i];
     }
 
-    return in;
+    m.center = (vmin + vmax) * 0.5f;
+    for (unsigned int i = m.first; i < m.first + m.count; i++)
+    {
+        for (const auto idx : faces[i].indices)
+        {
+            m.radius = std::max(m.radius, (vertices[idx] - m.center).magnitude());
+        }
+    }
+
+    m.cone_axis = axis.normalize();
+    if (m.cone_axis.magnitude() == 0.0f)
+    {
+        return; // degenerate faces only, keep cutoff that never culls
+    }
+
+    // smallest cosine between axis and any face normal, degenerate faces are always culled anyway
+    float min_cos = 1.0f;
+    for (unsigned int i = m.first; i < m.first + m.count; i++)
+    {
+        if (normals[i].magnitude() > 0.0f)
+        {
+            min_cos = std::min(min_cos, Vec3::dot(normals[i], m.cone_axis));
+        }
+    }
+
+    // cone wider than hemisphere can't be culled, small margin keeps test conservative
+    if (min_cos > 0.0f)
+    {
+        m.cone_cutoff = std::sqrt(1.0f - min_cos * min_cos) + 1e-4f;
+    }
 }
 
 // parse functions
 
 bool Object::validate() const
 {
-    if (vertices.empty() || faces.empty())
+    // vertices without faces are rendered as point cloud
+    if (vertices.empty())
     {
         std::cerr << "error: invalid object" << std::endl;
         return false;
@@ -64,69 +159,32 @@ bool Object::validate() const
     return true;
 }
 
-// parse v x y z
-bool Object::parse_vertex(const std::string &line)
+void Object::add_vertex(const Vec3 &v)
 {
-    std::stringstream ss(line);
-
-    float x, y, z;
-    if (!(ss >> x >> y >> z))
-    {
-        std::cerr << "warning: invalid vertex format" << std::endl;
-        return false;
-    }
+    vertices.push_back(v);
 
-    vertices.emplace_back(x, y, z);
-    return true;
+    bounds_min = Vec3(std::min(bounds_min.x, v.x), std::min(bounds_min.y, v.y), std::min(bounds_min.z, v.z));
+    bounds_max = Vec3(std::max(bounds_max.x, v.x), std::max(bounds_max.y, v.y), std::max(bounds_max.z, v.z));
 }
 
-// parse f
-bool Object::parse_face(const std::string &line, std::optional<int> current_material)
+std::optional<LoadIssue> Object::add_polygon(const std::span<const unsigned int> indices, const int material)
 {
-    std::stringstream ss(line);
-    std::vector<unsigned int> local_indices;
-
-    std::string token;
-    while (ss >> token)
-    {
-        if (const auto slash_pos = token.find('/'); slash_pos != std::string::npos)
-        {
-            token.erase(slash_pos); // keep only first index
-        }
-
-        auto maybe_idx = safe_stoi(token);
-        if (!maybe_idx)
-        {
-            std::cerr << "warning: invalid face token " << token << std::endl;
-            return false;
-        }
-
-        int ridx = relative_index(*maybe_idx, static_cast<int>(vertices.size()));
-        if (ridx < 0 || static_cast<size_t>(ridx) >= vertices.size())
-        {
-            std::cerr << "warning: vertex index " << *maybe_idx << " out of range" << std::endl;
-            return false;
-        }
-        local_indices.push_back(static_cast<unsigned int>(ridx));
-    }
-
-    if (local_indices.size() < 3)
+    if (indices.size() < 3)
     {
-        std::cerr << "warning: face contains less than 3 indexes" << std::endl;
-        return false;
+        return LoadIssue::ShortFace;
     }
 
-    if (local_indices.size() == 3)
+    if (indices.size() == 3)
     {
-        faces.emplace_back(local_indices[0], local_indices[1], local_indices[2], current_material);
-        return true;
+        add_face(indices[0], indices[1], indices[2], material);
+        return std::nullopt;
     }
 
     // triangularization
     std::vector<Vec3> polygon;
-    polygon.reserve(local_indices.size());
+    polygon.reserve(indices.size());
 
-    for (const auto idx : local_indices)
+    for (const auto idx : indices)
     {
         polygon.push_back(vertices[idx]);
     }
@@ -134,30 +192,129 @@ bool Object::parse_face(const std::string &line, std::optional<int> current_mate
     const auto result = triangularize(polygon);
     if (!result.has_value())
     {
-        std::cerr << "warning: triangularize failed" << std::endl;
-        return false;
+        return LoadIssue::TriangulationFailed;
     }
 
     // adding faces
     const auto &triangle_indices = result.value();
     for (size_t i = 0; i < triangle_indices.size(); i += 3)
     {
-        unsigned int i1 = local_indices[ triangle_indices[i] ];
-        unsigned int i2 = local_indices[ triangle_indices[i+1] ];
-        unsigned int i3 = local_indices[ triangle_indices[i+2] ];
-        faces.emplace_back(i1, i2, i3, current_material);
+        unsigned int i1 = indices[ triangle_indices[i] ];
+        unsigned int i2 = indices[ triangle_indices[i+1] ];
+        unsigned int i3 = indices[ triangle_indices[i+2] ];
+        add_face(i1, i2, i3, material);
     }
 
-    return true;
+    return std::nullopt;
 }
 
-// parse mtllib
-bool Object::parse_mtl_file(const std::string &line, const std::string &obj_filename)
+void Object::add_face(const unsigned int idx1, const unsigned int idx2, const unsigned int idx3, const int material)
 {
-    std::stringstream ss(line);
+    if (material_ranges.empty() || material_ranges.back().material != material)
+    {
+        material_ranges.emplace_back(static_cast<unsigned int>(faces.size()), 0, material);
+    }
+
+    faces.emplace_back(idx1, idx2, idx3);
+    material_ranges.back().count++;
+}
+
+int Object::face_material(const size_t face) const
+{
+    // last range starting at or before face
+    const auto it = std::upper_bound(material_ranges.begin(), material_ranges.end(), face,
+        [](const size_t f, const MaterialRange &range) { return f < range.first; });
+
+    return it == material_ranges.begin() ? -1 : std::prev(it)->material;
+}
+
+void Object::group_materials()
+{
+    // runs of faces in file order, each material may appear in many runs
+    std::vector<unsigned int> totals(materials.size() + 1, 0);
+    for (const auto &range : material_ranges)
+    {
+        totals[range.material + 1] += range.count;
+    }
+
+    if (std::ranges::count_if(totals, [](const unsigned int t) { return t > 0; }) == static_cast<long>(material_ranges.size()))
+    {
+        return; // already one range per material, in some order
+    }
+
+    // counting sort of runs by material, stable inside each material
+    std::vector<unsigned int> offsets(totals.size(), 0);
+    std::exclusive_scan(totals.begin(), totals.end(), offsets.begin(), 0u);
+
+    std::vector<Face> sorted(faces.size(), Face(0, 0, 0));
+    std::vector<unsigned int> cursor = offsets;
+
+    for (const auto &range : material_ranges)
+    {
+        unsigned int &at = cursor[range.material + 1];
+        std::copy_n(faces.begin() + range.first, range.count, sorted.begin() + at);
+        at += range.count;
+    }
+
+    faces = std::move(sorted);
+
+    material_ranges.clear();
+    for (size_t k = 0; k < totals.size(); k++)
+    {
+        if (totals[k] > 0)
+        {
+            material_ranges.emplace_back(offsets[k], totals[k], static_cast<int>(k) - 1);
+        }
+    }
+}
 
-    std::string mtl_filename;
-    ss >> mtl_filename;
+// parse v x y z
+std::optional<LoadIssue> Object::parse_vertex(std::string_view line)
+{
+    const auto x = parse_float(next_token(line));
+    const auto y = parse_float(next_token(line));
+    const auto z = parse_float(next_token(line));
+
+    if (!x || !y || !z)
+    {
+        vertices.emplace_back(0.0f, 0.0f, 0.0f);    // placeholder, bounds untouched
+        return LoadIssue::InvalidVertex;
+    }
+
+    add_vertex(Vec3(*x, *y, *z));
+    return std::nullopt;
+}
+
+// parse f
+std::optional<LoadIssue> Object::parse_face(std::string_view line, std::optional<int> current_material)
+{
+    std::vector<unsigned int> local_indices;
+
+    for (auto token = next_token(line); !token.empty(); token = next_token(line))
+    {
+        token = token.substr(0, token.find('/')); // keep only first index
+
+        auto maybe_idx = parse_int(token);
+        if (!maybe_idx)
+        {
+            return LoadIssue::InvalidFaceToken;
+        }
+
+        int ridx = relative_index(*maybe_idx, static_cast<int>(vertices.size()));
+        if (ridx < 0 || static_cast<size_t>(ridx) >= vertices.size())
+        {
+            return LoadIssue::IndexOutOfRange;
+        }
+        local_indices.push_back(static_cast<unsigned int>(ridx));
+    }
+
+    return add_polygon(local_indices, current_material.value_or(-1));
+}
+
+// parse mtllib
+bool Object::parse_mtl_file(std::string_view line, const std::string &obj_filename)
+{
+    const auto mtl_filename = next_token(line);
     if (mtl_filename.empty())
     {
         std::cerr << "error: can't parse mtl filename" << std::endl;
@@ -171,92 +328,134 @@ bool Object::parse_mtl_file(const std::string &line, const std::string &obj_file
 }
 
 // parse usemtl
-std::optional<int> Object::parse_material(const std::string &line) const
+std::optional<int> Object::parse_material(std::string_view line) const
 {
-    std::stringstream ss(line);
-
-    std::string material_name;
-    ss >> material_name;
-
-    return find_material(material_name);
+    return find_material(next_token(line));
 }
 
 // parse newmtl
-bool Object::parse_current_material(const std::string &line, std::string &current_name, Vec3 &current_diffuse, bool &have_active_material)
+bool Object::parse_current_material(std::string_view line, std::string &current_name, Vec3 &current_diffuse, bool &have_active_material)
 {
     if (have_active_material)
     {
         materials.emplace_back(current_name, current_diffuse);
     }
 
-    if (std::stringstream ss(line); !(ss >> current_name))
+    current_name = next_token(line);
+    if (current_name.empty())
     {
         std::cerr << "error: can't parse material name" << std::endl;
         return false;
-    };
+    }
     current_diffuse = Vec3(1.0f, 1.0f, 1.0f);
     have_active_material = true;
     return true;
 }
 
 // parse kd
-bool Object::parse_diffuse_color(const std::string &line, Vec3 &current_diffuse)
+bool Object::parse_diffuse_color(std::string_view line, Vec3 &current_diffuse)
 {
-    std::stringstream ss(line);
-
-    float r, g, b;
-    if (!(ss >> r >> g >> b))
+    const auto r = parse_float(next_token(line));
+    const auto g = parse_float(next_token(line));
+    const auto b = parse_float(next_token(line));
+    if (!r || !g || !b)
     {
         std::cerr << "error: can't parse diffuse colors" << std::endl;
         return false;
     }
 
-    current_diffuse = Vec3(r, g, b);
+    current_diffuse = Vec3(*r, *g, *b);
     return true;
 }
 
 // methods
-bool Object::load(const std::string &obj_filename, bool color_support)
+bool Object::load(const std::string &filename, bool color_support, const DiagnosticMode mode)
 {
-    auto file = open_file(obj_filename);
-    if (!file)
+    MappedFile file;
+    if (!file.open(filename))
     {
         return false;
     }
 
-    std::ifstream in = std::move(*file);
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::ranges::transform(extension, extension.begin(), [](const unsigned char c) { return std::tolower(c); });
 
-    std::optional<int> current_material = std::nullopt;
-    std::string line;
+    Diagnostics diagnostics(mode);
 
-    while (std::getline(in, line))
+    bool ok;
+    if (extension == ".stl")
+    {
+        ok = load_stl(*this, file.view(), diagnostics);
+    }
+    else if (extension == ".ply")
+    {
+        ok = load_ply(*this, file.view(), color_support, diagnostics);
+    }
+    else
     {
-        strip_line(line);
+        ok = load_obj(file.view(), filename, color_support, diagnostics);
+    }
 
-        if (line.empty() || line[0] == '#') // comment
-        {
-            continue;
-        }
+    if (!ok)
+    {
+        return false;
+    }
+
+    diagnostics.print_summary();
+
+    group_materials();
+    return validate();
+}
 
-        std::stringstream ss(line);
-        std::string cmd;
-        ss >> cmd;
+bool Object::load_obj(const std::string_view text, const std::string &obj_filename, const bool color_support, Diagnostics &diagnostics)
+{
+    // presize storage so parsing never reallocates
+    size_t vertex_total, face_total;
+    count_elements(text, vertex_total, face_total);
 
-        std::string arguments = line.substr(cmd.size());
-        if (!arguments.empty() && arguments[0] == ' ')
+    vertices.reserve(vertices.size() + vertex_total);
+    faces.reserve(faces.size() + face_total);
+
+    std::optional<int> current_material = std::nullopt;
+    std::string_view rest = text;
+    size_t line_number = 0;
+
+    std::vector<unsigned int> invalid_vertices;         // placeholders of malformed v lines
+    std::vector<std::pair<size_t, size_t>> face_lines;  // first face and line of f lines after first placeholder
+
+    while (!rest.empty())
+    {
+        std::string_view arguments = next_line(rest);
+        line_number++;
+
+        const std::string_view cmd = next_token(arguments);
+
+        if (cmd.empty() || cmd[0] == '#') // comment
         {
-            arguments.erase(0, 1);
+            continue;
         }
 
         bool ok = true;
+        std::optional<LoadIssue> issue;
 
         if (cmd == "v") // vertex
         {
-            ok = parse_vertex(arguments);
+            issue = parse_vertex(arguments);
+
+            if (issue)
+            {
+                invalid_vertices.push_back(static_cast<unsigned int>(vertices.size() - 1));
+            }
         }
         else if (cmd == "f") // face
         {
-            ok = parse_face(arguments, current_material);
+            // only later faces may use a placeholder
+            if (!invalid_vertices.empty())
+            {
+                face_lines.emplace_back(faces.size(), line_number);
+            }
+
+            issue = parse_face(arguments, current_material);
         }
         else if (color_support && cmd == "mtllib")  // material file
         {
@@ -268,53 +467,127 @@ bool Object::load(const std::string &obj_filename, bool color_support)
 
             if (!current_material)
             {
-                std::cerr << "warning: unknown material " << arguments << std::endl;
+                issue = LoadIssue::UnknownMaterial;
             }
         }
         // ignoring anything else
 
+        // malformed line is skipped unless diagnostics stop load
+        if (issue)
+        {
+            ok = diagnostics.report(*issue, line_number);
+        }
+
         if (!ok)
         {
             return false;
         }
     }
 
-    in.close();
-    return validate();
+    return drop_invalid_vertices(invalid_vertices, face_lines, diagnostics);
 }
 
-bool Object::load_materials(const std::string &mtl_filename)
+bool Object::drop_invalid_vertices(const std::span<const unsigned int> invalid, const std::span<const std::pair<size_t, size_t>> face_lines, Diagnostics &diagnostics)
 {
-    auto file = open_file(mtl_filename);
-    if (!file.has_value())
+    if (invalid.empty())
     {
-        return false;
+        return true;
     }
 
-    std::ifstream in = std::move(*file);
+    // new index per vertex, placeholders map to none
+    static constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(vertices.size());
 
-    std::string current_name;
-    Vec3 current_diffuse(1.0f, 1.0f, 1.0f);
-    bool have_active_material = false;
-    std::string line;
+    size_t next = 0;
+    auto skip = invalid.begin();
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        if (skip != invalid.end() && *skip == i)
+        {
+            remap[i] = none;
+            ++skip;
+            continue;
+        }
 
-    while (std::getline(in, line))
+        remap[i] = static_cast<unsigned int>(next);
+        vertices[next++] = vertices[i];
+    }
+
+    vertices.resize(next);
+
+    for (auto &f : faces)
     {
-        strip_line(line);
+        for (auto &idx : f.indices)
+        {
+            idx = remap[idx];
+        }
+    }
 
-        if (line.empty() || line[0] == '#') // comment
+    // all faces of f line using placeholder marked, triangulation of that polygon is unreliable
+    for (size_t k = 0; k < face_lines.size(); k++)
+    {
+        const auto begin = faces.begin() + static_cast<long>(face_lines[k].first);
+        const auto end = k + 1 < face_lines.size() ? faces.begin() + static_cast<long>(face_lines[k + 1].first) : faces.end();
+
+        const bool uses_invalid = std::any_of(begin, end, [](const Face &f) { return std::ranges::find(f.indices, none) != f.indices.end(); });
+        if (!uses_invalid)
+        {
             continue;
+        }
+
+        std::for_each(begin, end, [](Face &f) { f.indices[0] = none; });
+
+        if (!diagnostics.report(LoadIssue::InvalidFaceVertex, face_lines[k].second))
+        {
+            return false;
+        }
+    }
 
-        std::stringstream ss(line);
-        std::string cmd;
-        ss >> cmd;
+    // marked faces dropped, material ranges shrink accordingly
+    size_t kept = 0;
+    for (auto &range : material_ranges)
+    {
+        const size_t first = kept;
 
-        std::string arguments = line.substr(cmd.size());
-        if (!arguments.empty() && arguments[0] == ' ')
+        for (unsigned int i = range.first; i < range.first + range.count; i++)
         {
-            arguments.erase(0, 1);
+            if (faces[i].indices[0] != none)
+            {
+                faces[kept++] = faces[i];
+            }
         }
 
+        range.first = static_cast<unsigned int>(first);
+        range.count = static_cast<unsigned int>(kept - first);
+    }
+
+    faces.erase(faces.begin() + static_cast<long>(kept), faces.end());
+    std::erase_if(material_ranges, [](const MaterialRange &range) { return range.count == 0; });
+
+    return true;
+}
+
+bool Object::load_materials(const std::string &mtl_filename)
+{
+    MappedFile file;
+    if (!file.open(mtl_filename))
+    {
+        return false;
+    }
+
+    std::string current_name;
+    Vec3 current_diffuse(1.0f, 1.0f, 1.0f);
+    bool have_active_material = false;
+    std::string_view rest = file.view();
+
+    while (!rest.empty())
+    {
+        std::string_view arguments = next_line(rest);
+        const std::string_view cmd = next_token(arguments);
+
+        if (cmd.empty() || cmd[0] == '#') // comment
+            continue;
+
         if (cmd == "newmtl") // current material
         {
             parse_current_material(arguments, current_name, current_diffuse, have_active_material);
@@ -334,91 +607,469 @@ bool Object::load_materials(const std::string &mtl_filename)
 }
 
 // find material by index
-std::optional<int> Object::find_material(const std::string &material_name) const
+std::optional<int> Object::find_material(const std::string_view material_name) const
 {
     const auto it = std::ranges::find_if(materials, [&material_name](const Material &m){ return m.material_name == material_name; });
     return (it != materials.end()) ? std::make_optional(std::distance(materials.begin(), it)) : std::nullopt;
 }
 
-void Object::scale(float factor)
+// affine transform of all load time options, vertices are visited once
+void Object::place(const float size, const bool flip, const bool invert_x, const bool invert_y, const bool invert_z)
 {
-    for (auto &v : vertices)
+    if (!vertices.empty())
     {
-        v *= factor;
+        // vertices not added through add_vertex()
+        if (bounds_min.x > bounds_max.x)
+        {
+            for (const auto &v : vertices)
+            {
+                bounds_min = Vec3(std::min(bounds_min.x, v.x), std::min(bounds_min.y, v.y), std::min(bounds_min.z, v.z));
+                bounds_max = Vec3(std::max(bounds_max.x, v.x), std::max(bounds_max.y, v.y), std::max(bounds_max.z, v.z));
+            }
+        }
+
+        const Vec3 center = (bounds_min + bounds_max) * 0.5f;
+        const float scale = size / std::max({
+            bounds_max.x - bounds_min.x,
+            bounds_max.y - bounds_min.y,
+            bounds_max.z - bounds_min.z,
+            1e-6f
+        });
+
+        // per axis factor, sign mirrors axis
+        const float sx = invert_x ? -scale : scale;
+        const float sy = invert_y ? -scale : scale;
+        const float sz = invert_z ? -scale : scale;
+
+        parallel_for(vertices.size(), [&](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                Vec3 &v = vertices[i];
+                v = Vec3((v.x - center.x) * sx, (v.y - center.y) * sy, (v.z - center.z) * sz);
+            }
+        });
+
+        const Vec3 a((bounds_min.x - center.x) * sx, (bounds_min.y - center.y) * sy, (bounds_min.z - center.z) * sz);
+        const Vec3 b((bounds_max.x - center.x) * sx, (bounds_max.y - center.y) * sy, (bounds_max.z - center.z) * sz);
+        bounds_min = Vec3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+        bounds_max = Vec3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+    }
+
+    // every mirrored axis reverses winding, even count cancels out
+    if (flip != (invert_x != (invert_y != invert_z)))
+    {
+        flip_faces();
     }
 }
 
-// normalize verts of object
-void Object::normalize()
+void Object::flip_faces()
 {
-    if (vertices.empty())
+    for (auto &f : faces)
+    {
+        std::swap(f.indices[1], f.indices[2]);
+    }
+}
+
+size_t Object::weld(const float epsilon)
+{
+    std::vector<Vec3> unique;
+    const auto remap = weld_points(vertices, epsilon, unique);
+
+    for (auto &f : faces)
+    {
+        for (auto &idx : f.indices)
+        {
+            idx = remap[idx];
+        }
+    }
+
+    // faces collapsed by welding, material ranges shrink accordingly
+    size_t kept = 0;
+    for (auto &range : material_ranges)
+    {
+        const size_t first = kept;
+
+        for (unsigned int i = range.first; i < range.first + range.count; i++)
+        {
+            if (const Face &f = faces[i]; f.indices[0] != f.indices[1] && f.indices[1] != f.indices[2] && f.indices[0] != f.indices[2])
+            {
+                faces[kept++] = f;
+            }
+        }
+
+        range.first = static_cast<unsigned int>(first);
+        range.count = static_cast<unsigned int>(kept - first);
+    }
+
+    faces.erase(faces.begin() + static_cast<long>(kept), faces.end());
+    std::erase_if(material_ranges, [](const MaterialRange &range) { return range.count == 0; });
+
+    const size_t removed = vertices.size() - unique.size();
+    vertices = std::move(unique);
+
+    return removed;
+}
+
+void Object::compute_normals()
+{
+    normals.resize(faces.size());
+
+    for (size_t i = 0; i < faces.size(); i++)
+    {
+        normals[i] = face_normal(faces[i], vertices);
+    }
+}
+
+void Object::build_meshlets()
+{
+    meshlets.clear();
+
+    const size_t fcount = faces.size();
+    if (fcount == 0)
     {
         return;
     }
 
-    Vec3 vmin = vertices[0];
-    Vec3 vmax = vertices[0];
+    if (normals.size() != fcount)
+    {
+        compute_normals();
+    }
 
-    for (const auto &v : vertices)
+    // vertex to faces adjacency
+    std::vector<unsigned int> offsets(vertices.size() + 1, 0);
+    for (const auto &f : faces)
+    {
+        for (const auto idx : f.indices)
+        {
+            offsets[idx + 1]++;
+        }
+    }
+
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<unsigned int> adjacency(offsets.back());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < fcount; i++)
     {
-        vmin.x = std::min(vmin.x, v.x);
-        vmin.y = std::min(vmin.y, v.y);
-        vmin.z = std::min(vmin.z, v.z);
+        for (const auto idx : faces[i].indices)
+        {
+            adjacency[fill[idx]++] = static_cast<unsigned int>(i);
+        }
+    }
+
+    // grow clusters from seed faces over shared vertices while normals stay close to cluster axis
+    std::vector<bool> assigned(fcount, false);
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> queue;
+    order.reserve(fcount);
 
-        vmax.x = std::max(vmax.x, v.x);
-        vmax.y = std::max(vmax.y, v.y);
-        vmax.z = std::max(vmax.z, v.z);
+    // meshlets never cross material ranges, so ranges keep their place in new order
+    std::vector<unsigned int> range_of(fcount, 0);
+    for (unsigned int r = 0; r < material_ranges.size(); r++)
+    {
+        const MaterialRange &range = material_ranges[r];
+        std::fill_n(range_of.begin() + range.first, range.count, r);
     }
 
-    const Vec3 center = (vmin + vmax) * 0.5f;
-    const float scale = 1.0f / std::max({
-        vmax.x - vmin.x,
-        vmax.y - vmin.y,
-        vmax.z - vmin.z,
-        1e-6f
-    });
+    for (size_t seed = 0; seed < fcount; seed++)
+    {
+        if (assigned[seed])
+        {
+            continue;
+        }
+
+        const int material = material_ranges.empty() ? -1 : material_ranges[range_of[seed]].material;
+        Meshlet m(static_cast<unsigned int>(order.size()), 0, material);
+        Vec3 axis_sum = normals[seed];
+
+        queue.clear();
+        queue.push_back(static_cast<unsigned int>(seed));
+        assigned[seed] = true;
+
+        for (size_t head = 0; head < queue.size() && m.count < MESHLET_MAX_FACES; head++)
+        {
+            const unsigned int fi = queue[head];
+            order.push_back(fi);
+            m.count++;
+
+            const Vec3 axis = axis_sum.normalize();
+
+            for (const auto idx : faces[fi].indices)
+            {
+                for (unsigned int k = offsets[idx]; k < offsets[idx + 1]; k++)
+                {
+                    const unsigned int nb = adjacency[k];
+                    if (assigned[nb] || queue.size() >= MESHLET_MAX_FACES || range_of[nb] != range_of[seed])
+                    {
+                        continue;
+                    }
+
+                    if (axis.magnitude() > 0.0f && normals[nb].magnitude() > 0.0f && Vec3::dot(normals[nb], axis) < MESHLET_CONE_COS)
+                    {
+                        continue;
+                    }
+
+                    assigned[nb] = true;
+                    queue.push_back(nb);
+                    axis_sum += normals[nb];
+                }
+            }
+        }
+
+        meshlets.push_back(m);
+    }
+
+    // faces and normals in meshlet order
+    std::vector<Face> sorted;
+    std::vector<Vec3> sorted_normals;
+    sorted.reserve(fcount);
+    sorted_normals.reserve(fcount);
+    for (const auto fi : order)
+    {
+        sorted.push_back(faces[fi]);
+        sorted_normals.push_back(normals[fi]);
+    }
+
+    faces = std::move(sorted);
+    normals = std::move(sorted_normals);
 
-    for (auto &v : vertices)
+    for (auto &m : meshlets)
     {
-        v = (v - center) * scale;
+        meshlet_bounds(m, faces, normals, vertices);
     }
 }
 
-void Object::flip_faces()
+void Object::optimize_cache()
 {
+    // reorder faces inside each meshlet, keeping meshlet ranges intact
+    std::vector<std::pair<unsigned int, unsigned int>> ranges;
+    for (const auto &m : meshlets)
+    {
+        ranges.emplace_back(m.first, m.count);
+    }
+
+    if (ranges.empty())
+    {
+        ranges.emplace_back(0, static_cast<unsigned int>(faces.size()));
+    }
+
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> optimized;
+    std::vector<Face> range_faces;
+    std::vector<Vec3> range_normals;
+
+    for (const auto &[first, count] : ranges)
+    {
+        indices.clear();
+        for (unsigned int i = first; i < first + count; i++)
+        {
+            indices.insert(indices.end(), faces[i].indices.begin(), faces[i].indices.end());
+        }
+
+        const auto order = optimize_vertex_cache(indices);
+
+        // existing order kept when optimized one misses cache as often or more
+        const float before = ::acmr(indices, VERTEX_CACHE_SIZE);
+
+        optimized.clear();
+        for (const auto i : order)
+        {
+            optimized.insert(optimized.end(), faces[first + i].indices.begin(), faces[first + i].indices.end());
+        }
+
+        if (::acmr(optimized, VERTEX_CACHE_SIZE) >= before)
+        {
+            continue;
+        }
+
+        range_faces.assign(faces.begin() + first, faces.begin() + first + count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            faces[first + i] = range_faces[order[i]];
+        }
+
+        if (normals.size() == faces.size())
+        {
+            range_normals.assign(normals.begin() + first, normals.begin() + first + count);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                normals[first + i] = range_normals[order[i]];
+            }
+        }
+    }
+
+    // vertices in order of first use by faces, unused vertices at end
+    constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(vertices.size(), none);
+    std::vector<Vec3> sorted;
+    sorted.reserve(vertices.size());
+
     for (auto &f : faces)
     {
-        std::swap(f.indices[1], f.indices[2]);
+        for (auto &idx : f.indices)
+        {
+            if (remap[idx] == none)
+            {
+                remap[idx] = static_cast<unsigned int>(sorted.size());
+                sorted.push_back(vertices[idx]);
+            }
+
+            idx = remap[idx];
+        }
     }
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        if (remap[i] == none)
+        {
+            sorted.push_back(vertices[i]);
+        }
+    }
+
+    vertices = std::move(sorted);
 }
 
-void Object::invert_x()
+float Object::acmr() const
 {
-    for (auto &v : vertices)
+    std::vector<unsigned int> indices;
+    indices.reserve(faces.size() * 3);
+
+    for (const auto &f : faces)
     {
-        v.x = -v.x;
+        indices.insert(indices.end(), f.indices.begin(), f.indices.end());
     }
 
-    flip_faces();
+    return ::acmr(indices, VERTEX_CACHE_SIZE);
 }
 
-void Object::invert_y()
+void Object::request_lods(const size_t max_faces) const
 {
-    for (auto &v : vertices)
+    std::call_once(*lods_once, [this, max_faces] {
+        lods_state->store(LodState::Building, std::memory_order_release);
+        lods_worker = std::jthread([this, max_faces](const std::stop_token stop) { build_lods(max_faces, stop); });
+    });
+}
+
+void Object::wait_lods() const
+{
+    if (lods_worker.joinable())
     {
-        v.y = -v.y;
+        lods_worker.join();
     }
+}
 
-    flip_faces();
+std::span<const Object> Object::levels() const
+{
+    if (lod_state() != LodState::Ready)
+    {
+        return {};
+    }
+
+    return lods;
+}
+
+void Object::build_lods(const size_t max_faces, const std::stop_token stop) const
+{
+    // simplification needs float positions
+    Object dequantized;
+    if (compacted())
+    {
+        dequantized.vertices.reserve(qvertices.size());
+        for (const auto &q : qvertices)
+        {
+            dequantized.vertices.emplace_back(q.x * qscale, q.y * qscale, q.z * qscale);
+        }
+
+        dequantized.faces = faces;
+        dequantized.material_ranges = material_ranges;
+    }
+
+    std::vector<Object> built;
+
+    while (built.size() < LOD_MAX_LEVELS)
+    {
+        const Object &source = !built.empty() ? built.back() : compacted() ? dequantized : *this;
+
+        // levels finer than screen can show are never selected
+        const size_t target = std::min(source.faces.size() / 2, max_faces);
+
+        if (target < LOD_MIN_FACES)
+        {
+            break;
+        }
+
+        Object level = simplify(source, target, stop);
+
+        if (stop.stop_requested())
+        {
+            return;
+        }
+
+        // stop when mesh can't be reduced any further
+        if (level.faces.size() > source.faces.size() * 3 / 4)
+        {
+            break;
+        }
+
+        built.push_back(std::move(level));
+    }
+
+    // compact levels only after all simplified from float positions
+    if (compacted())
+    {
+        for (auto &level : built)
+        {
+            level.compact();
+        }
+    }
+
+    lods = std::move(built);
+    lods_state->store(LodState::Ready, std::memory_order_release);
+}
+
+void Object::build_bvh()
+{
+    hierarchy();
 }
 
+const Bvh &Object::hierarchy() const
+{
+    std::call_once(*bvh_once, [this] { bvh.build(*this); });
+    return bvh;
+}
 
-void Object::invert_z()
+float Object::compact()
 {
-    for (auto &v : vertices)
+    if (vertices.empty())
+    {
+        return 0.0f;
+    }
+
+    // symmetric range around origin, object is centered by place()
+    float extent = 1e-6f;
+    for (const auto &v : vertices)
+    {
+        extent = std::max({extent, std::fabs(v.x), std::fabs(v.y), std::fabs(v.z)});
+    }
+
+    qscale = extent / static_cast<float>(INT16_MAX);
+    qvertices.resize(vertices.size());
+
+    float error = 0.0f;
+    auto quantize = [this, &error](const float c) {
+        const auto q = static_cast<int16_t>(std::lround(c / qscale));
+        error = std::max(error, std::fabs(static_cast<float>(q) * qscale - c));
+        return q;
+    };
+
+    for (size_t i = 0; i < vertices.size(); i++)
     {
-        v.z = -v.z;
+        const Vec3 &v = vertices[i];
+        qvertices[i] = QVertex{quantize(v.x), quantize(v.y), quantize(v.z)};
     }
 
-    flip_faces();
+    vertices.clear();
+    vertices.shrink_to_fit();
+
+    return error;
 }
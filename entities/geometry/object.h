@@ -5,8 +5,13 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <filesystem>
 #include <fstream>
@@ -14,18 +19,41 @@
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <utility>
 
 #include "utils/algorithms.h"
 #include "utils/tools.h"
+#include "bvh.h"
+#include "diagnostics.h"
 
 // triangular face
 class Face {
 public:
     std::array<unsigned int, 3> indices;    // indices of vertices
-    std::optional<int> material;            // index of material
 
-    Face(const unsigned int idx1, const unsigned int idx2, const unsigned int idx3, const std::optional<int> mat = std::nullopt) : indices{idx1, idx2, idx3}, material(mat) {}
+    Face(const unsigned int idx1, const unsigned int idx2, const unsigned int idx3) : indices{idx1, idx2, idx3} {}
+};
+
+// contiguous faces sharing material
+class MaterialRange {
+public:
+    unsigned int first;     // index of first face
+    unsigned int count;     // number of faces
+    int material;           // material index, -1 without material
+
+    MaterialRange(const unsigned int first, const unsigned int count, const int material) : first(first), count(count), material(material) {}
+};
+
+// vertex position in fixed point, scaled by object quantization step
+class QVertex {
+public:
+    int16_t x, y, z;
 };
 
 // material properties
@@ -37,6 +65,27 @@ public:
     Material(const std::string &name, const Vec3 &color) : material_name(name), diffuse(color) {}
 };
 
+// cluster of neighbouring faces with bounds for cluster culling
+class Meshlet {
+public:
+    unsigned int first;     // index of first face
+    unsigned int count;     // number of faces
+    Vec3 center;            // bounding sphere center
+    float radius;           // bounding sphere radius
+    Vec3 cone_axis;         // normal cone axis
+    float cone_cutoff;      // sine of cone half-angle, back-facing when axis and view dot exceeds it
+    int material;           // material of all faces, -1 without material
+
+    Meshlet(const unsigned int first, const unsigned int count, const int material = -1) : first(first), count(count), radius(0.0f), cone_cutoff(2.0f), material(material) {}
+};
+
+// progress of background level of detail build
+enum class LodState : uint8_t {
+    None,       // not requested
+    Building,   // simplifying in background, full detail drawn meanwhile
+    Ready       // levels() final
+};
+
 // object (3d model)
 class Object {
 public:
@@ -44,34 +93,81 @@ public:
 
     std::vector<Vec3> vertices;
     std::vector<Face> faces;
+    std::vector<Vec3> normals;      // unit normal per face
+    std::vector<MaterialRange> material_ranges; // one contiguous range of faces per material, covering all faces
     std::vector<Material> materials;
+    std::vector<Meshlet> meshlets;
+    mutable std::vector<Object> lods;   // simplified levels of detail, from finest to coarsest, read through levels()
+    mutable Bvh bvh;                // hierarchy for ray casting, built by build_bvh() or hierarchy(), read through hierarchy() while rendering
 
-    // load obj file with optional material mtl support
-    bool load(const std::string &obj_filename, bool color_support = false);
+    std::vector<QVertex> qvertices; // compact positions replacing vertices after compact()
+    float qscale = 0.0f;            // position of compact vertex is its value times scale
 
+    // vertex bounds, gathered by add_vertex() while loading
+    Vec3 bounds_min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    Vec3 bounds_max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
 
-    void normalize();           // normalize object
-    void scale(float factor);   // scale object
-    void flip_faces();          // flip faces winding order
+    // load obj file with optional material mtl support, stl or ply file by extension, malformed lines handled by mode
+    bool load(const std::string &filename, bool color_support = false, DiagnosticMode mode = DiagnosticMode::Normal);
 
-    void invert_x();    // invert axes
-    void invert_y();
-    void invert_z();
+    // center, fit largest extent to size and mirror axes in one pass over vertices, winding flipped once if needed
+    void place(float size, bool flip, bool invert_x, bool invert_y, bool invert_z);
+
+    void flip_faces();          // flip faces winding order
+    size_t weld(float epsilon); // merge vertices closer than epsilon, returns number of removed vertices
+
+    [[nodiscard]] float acmr() const;   // average cache miss ratio of face order
+    [[nodiscard]] bool point_cloud() const { return faces.empty(); }
+    [[nodiscard]] int face_material(size_t face) const;  // -1 without material
+
+    void add_vertex(const Vec3 &v);     // appends vertex and grows bounds
+    void add_face(unsigned int idx1, unsigned int idx2, unsigned int idx3, int material);    // appends to last material range
+    std::optional<LoadIssue> add_polygon(std::span<const unsigned int> indices, int material); // triangularizes more than 3 valid indices
+
+    [[nodiscard]] bool compacted() const { return !qvertices.empty(); }
+    [[nodiscard]] size_t vertex_count() const { return compacted() ? qvertices.size() : vertices.size(); }
+
+    // per-face data, call after all transformations
+    void compute_normals();     // unit face normals
+    void build_meshlets();      // group faces into meshlets, reorders faces
+    void optimize_cache();      // vertex cache friendly face order inside meshlets unless existing one is better, vertices in order of first use
+    void request_lods(size_t max_faces) const;  // starts building levels in background on first call, levels above max_faces skipped, object must not move afterwards
+    void wait_lods() const;                     // blocks until requested levels are built
+    [[nodiscard]] std::span<const Object> levels() const;  // empty until background build finished
+    [[nodiscard]] LodState lod_state() const { return lods_state->load(std::memory_order_acquire); }
+    void build_bvh();           // bounding volume hierarchy over faces, call after face order is final
+    const Bvh &hierarchy() const;   // builds hierarchy on first call, safe from several render threads
+    float compact();            // 16-bit vertices, returns max position error, call last, levels built later are compacted too
 
 private:
+    bool load_obj(std::string_view text, const std::string &obj_filename, bool color_support, Diagnostics &diagnostics);
+
     // material related methods
     bool load_materials(const std::string &mtl_filename);
-    std::optional<int> find_material(const std::string &material_name) const;
+    std::optional<int> find_material(std::string_view material_name) const;
+
+    // composite methods of parser, malformed line reported as issue
+    std::optional<LoadIssue> parse_vertex(std::string_view line);   // invalid vertex keeps numbering as placeholder outside bounds
+    std::optional<LoadIssue> parse_face(std::string_view line, std::optional<int> current_material);
+    bool parse_mtl_file(std::string_view line, const std::string &obj_filename);
+    std::optional<int> parse_material(std::string_view line) const;
+    bool parse_current_material(std::string_view line, std::string &current_name, Vec3 &current_diffuse, bool &have_active_material);
+    static bool parse_diffuse_color(std::string_view line, Vec3 &current_diffuse);
 
-    // composite methods of parser
-    bool parse_vertex(const std::string &line);
-    bool parse_face(const std::string &line, std::optional<int> current_material);
-    bool parse_mtl_file(const std::string &line, const std::string &obj_filename);
-    std::optional<int> parse_material(const std::string &line) const;
-    bool parse_current_material(const std::string &line, std::string &current_name, Vec3 &current_diffuse, bool &have_active_material);
-    static bool parse_diffuse_color(const std::string &line, Vec3 &current_diffuse);
+    // placeholders of invalid vertices removed, faces using them dropped and reported per line
+    bool drop_invalid_vertices(std::span<const unsigned int> invalid, std::span<const std::pair<size_t, size_t>> face_lines, Diagnostics &diagnostics);
 
     // validation of object after parsing
     bool validate() const;
 
+    void group_materials();     // stable sort of faces into one range per material
+
+    // simplified copies with halved face count, first level capped at max_faces, abandoned on stop
+    void build_lods(size_t max_faces, std::stop_token stop) const;
+
+    std::unique_ptr<std::once_flag> bvh_once = std::make_unique<std::once_flag>();
+    std::unique_ptr<std::once_flag> lods_once = std::make_unique<std::once_flag>();
+    std::unique_ptr<std::atomic<LodState>> lods_state = std::make_unique<std::atomic<LodState>>(LodState::None);
+    mutable std::jthread lods_worker;   // declared last, stopped and joined before rest of object is destroyed
+
 };
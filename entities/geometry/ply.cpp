@@ -0,0 +1,369 @@
+/*
+ * ply.cpp
+ */
+
+#include "ply.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "config.h"
+
+// helper classes
+
+enum class PlyType {
+    Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, None
+};
+
+// meaning of property for loader
+enum class PlyRole {
+    X, Y, Z, Red, Green, Blue, Indices, None
+};
+
+// scalar or list property of element
+class PlyProperty {
+public:
+    PlyType type;           // value type, entry type for list
+    PlyType count_type;     // length type for list, None for scalar
+    PlyRole role;
+
+    PlyProperty(const PlyType type, const PlyType count_type, const PlyRole role) : type(type), count_type(count_type), role(role) {}
+};
+
+// block of records with same properties
+class PlyElement {
+public:
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+
+    PlyElement(const std::string_view name, const size_t count) : name(name), count(count) {}
+};
+
+// helper functions
+
+static PlyType ply_type(const std::string_view name)
+{
+    if (name == "char" || name == "int8")                           return PlyType::Int8;
+    if (name == "uchar" || name == "uint8")                         return PlyType::UInt8;
+    if (name == "short" || name == "int16")                         return PlyType::Int16;
+    if (name == "ushort" || name == "uint16")                       return PlyType::UInt16;
+    if (name == "int" || name == "int32")                           return PlyType::Int32;
+    if (name == "uint" || name == "uint32")                         return PlyType::UInt32;
+    if (name == "float" || name == "float32")                       return PlyType::Float32;
+    if (name == "double" || name == "float64")                      return PlyType::Float64;
+    return PlyType::None;
+}
+
+static size_t type_size(const PlyType type)
+{
+    switch (type)
+    {
+        case PlyType::Int8: case PlyType::UInt8:                    return 1;
+        case PlyType::Int16: case PlyType::UInt16:                  return 2;
+        case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32:   return 4;
+        case PlyType::Float64:                                      return 8;
+        default:                                                    return 0;
+    }
+}
+
+// value of little endian scalar
+static double read_scalar(const char *p, const PlyType type)
+{
+    switch (type)
+    {
+        case PlyType::Int8:     { int8_t v;   std::memcpy(&v, p, sizeof(v)); return v; }
+        case PlyType::UInt8:    { uint8_t v;  std::memcpy(&v, p, sizeof(v)); return v; }
+        case PlyType::Int16:    { int16_t v;  std::memcpy(&v, p, sizeof(v)); return v; }
+        case PlyType::UInt16:   { uint16_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+        case PlyType::Int32:    { int32_t v;  std::memcpy(&v, p, sizeof(v)); return v; }
+        case PlyType::UInt32:   { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+        case PlyType::Float32:  { float v;    std::memcpy(&v, p, sizeof(v)); return v; }
+        case PlyType::Float64:  { double v;   std::memcpy(&v, p, sizeof(v)); return v; }
+        default:                return 0.0;
+    }
+}
+
+static PlyRole property_role(const std::string_view element, const std::string_view name)
+{
+    if (element == "vertex")
+    {
+        if (name == "x")        return PlyRole::X;
+        if (name == "y")        return PlyRole::Y;
+        if (name == "z")        return PlyRole::Z;
+        if (name == "red")      return PlyRole::Red;
+        if (name == "green")    return PlyRole::Green;
+        if (name == "blue")     return PlyRole::Blue;
+    }
+    else if (element == "face" && (name == "vertex_indices" || name == "vertex_index"))
+    {
+        return PlyRole::Indices;
+    }
+
+    return PlyRole::None;
+}
+
+// elements of header, text is advanced to first data byte
+static std::optional<std::vector<PlyElement>> parse_header(std::string_view &text)
+{
+    std::string_view line = next_line(text);
+    if (next_token(line) != "ply")
+    {
+        std::cerr << "error: invalid ply file" << std::endl;
+        return std::nullopt;
+    }
+
+    std::vector<PlyElement> elements;
+
+    while (!text.empty())
+    {
+        line = next_line(text);
+        const std::string_view cmd = next_token(line);
+
+        if (cmd == "format")
+        {
+            if (const auto format = next_token(line); format != "binary_little_endian")
+            {
+                std::cerr << "error: unsupported ply format " << format << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (cmd == "element")
+        {
+            const auto name = next_token(line);
+            const auto count = parse_int(next_token(line));
+            if (!count || *count < 0)
+            {
+                std::cerr << "error: invalid ply element " << name << std::endl;
+                return std::nullopt;
+            }
+
+            elements.emplace_back(name, static_cast<size_t>(*count));
+        }
+        else if (cmd == "property")
+        {
+            if (elements.empty())
+            {
+                std::cerr << "error: ply property outside of element" << std::endl;
+                return std::nullopt;
+            }
+
+            auto type_name = next_token(line);
+            PlyType count_type = PlyType::None;
+
+            if (type_name == "list")
+            {
+                count_type = ply_type(next_token(line));
+                type_name = next_token(line);
+
+                if (count_type == PlyType::None)
+                {
+                    std::cerr << "error: invalid ply property type" << std::endl;
+                    return std::nullopt;
+                }
+            }
+
+            const PlyType type = ply_type(type_name);
+            if (type == PlyType::None)
+            {
+                std::cerr << "error: invalid ply property type " << type_name << std::endl;
+                return std::nullopt;
+            }
+
+            auto &element = elements.back();
+            element.properties.emplace_back(type, count_type, property_role(element.name, next_token(line)));
+        }
+        else if (cmd == "end_header")
+        {
+            return elements;
+        }
+        // ignoring comment and obj_info
+    }
+
+    std::cerr << "error: ply header without end_header" << std::endl;
+    return std::nullopt;
+}
+
+bool load_ply(Object &obj, std::string_view text, const bool color_support, Diagnostics &diagnostics)
+{
+    const auto elements = parse_header(text);
+    if (!elements)
+    {
+        return false;
+    }
+
+    const char *p = text.data();
+    const char *const end = p + text.size();
+
+    const auto base = static_cast<unsigned int>(obj.vertices.size());
+    size_t vertex_count = 0;
+
+    // vertex colors in 0-255, filled only with color support
+    std::vector<std::array<uint8_t, 3>> colors;
+
+    // material of each quantized color, created on first use
+    constexpr size_t levels = PLY_COLOR_LEVELS;
+    std::vector<int> color_materials(levels * levels * levels, -1);
+
+    std::vector<unsigned int> polygon;      // reused for every face
+
+    for (const auto &element : *elements)
+    {
+        const bool vertex = element.name == "vertex";
+        const bool face = element.name == "face";
+
+        if (vertex)
+        {
+            obj.vertices.reserve(obj.vertices.size() + element.count);
+        }
+        else if (face)
+        {
+            obj.faces.reserve(obj.faces.size() + element.count);
+        }
+
+        const bool has_colors = vertex && color_support && std::ranges::any_of(element.properties, [](const PlyProperty &prop) { return prop.role == PlyRole::Red; });
+        if (has_colors)
+        {
+            colors.reserve(element.count);
+        }
+
+        for (size_t r = 0; r < element.count; r++)
+        {
+            float values[6] = {0.0f, 0.0f, 0.0f, 255.0f, 255.0f, 255.0f};    // x, y, z, red, green, blue
+            polygon.clear();
+
+            for (const auto &prop : element.properties)
+            {
+                const size_t size = type_size(prop.type);
+
+                if (prop.count_type != PlyType::None)
+                {
+                    const size_t count_size = type_size(prop.count_type);
+                    if (static_cast<size_t>(end - p) < count_size)
+                    {
+                        std::cerr << "error: truncated ply file" << std::endl;
+                        return false;
+                    }
+
+                    const auto n = static_cast<size_t>(std::max(0.0, read_scalar(p, prop.count_type)));
+                    p += count_size;
+
+                    if (static_cast<size_t>(end - p) / size < n)
+                    {
+                        std::cerr << "error: truncated ply file" << std::endl;
+                        return false;
+                    }
+
+                    if (prop.role == PlyRole::Indices)
+                    {
+                        for (size_t i = 0; i < n; i++)
+                        {
+                            polygon.push_back(static_cast<unsigned int>(static_cast<int64_t>(read_scalar(p + i * size, prop.type))));
+                        }
+                    }
+
+                    p += n * size;
+                    continue;
+                }
+
+                if (static_cast<size_t>(end - p) < size)
+                {
+                    std::cerr << "error: truncated ply file" << std::endl;
+                    return false;
+                }
+
+                if (prop.role <= PlyRole::Blue)
+                {
+                    auto value = static_cast<float>(read_scalar(p, prop.type));
+
+                    // float colors are in 0-1
+                    if (prop.role >= PlyRole::Red && (prop.type == PlyType::Float32 || prop.type == PlyType::Float64))
+                    {
+                        value *= 255.0f;
+                    }
+
+                    values[static_cast<size_t>(prop.role)] = value;
+                }
+
+                p += size;
+            }
+
+            if (vertex)
+            {
+                obj.add_vertex(Vec3(values[0], values[1], values[2]));
+
+                if (has_colors)
+                {
+                    colors.push_back({
+                        static_cast<uint8_t>(std::clamp(values[3], 0.0f, 255.0f)),
+                        static_cast<uint8_t>(std::clamp(values[4], 0.0f, 255.0f)),
+                        static_cast<uint8_t>(std::clamp(values[5], 0.0f, 255.0f))
+                    });
+                }
+            }
+            else if (face)
+            {
+                std::optional<LoadIssue> issue;
+                int material = -1;
+
+                for (auto &idx : polygon)
+                {
+                    if (idx >= vertex_count)
+                    {
+                        issue = LoadIssue::IndexOutOfRange;
+                    }
+                    idx += base;
+                }
+
+                // average corner color quantized to material
+                if (!issue && !colors.empty() && !polygon.empty())
+                {
+                    unsigned int sum[3] = {0, 0, 0};
+                    for (const auto idx : polygon)
+                    {
+                        for (size_t c = 0; c < 3; c++)
+                        {
+                            sum[c] += colors[idx - base][c];
+                        }
+                    }
+
+                    size_t key = 0;
+                    for (size_t c = 0; c < 3; c++)
+                    {
+                        const float mean = static_cast<float>(sum[c]) / static_cast<float>(polygon.size() * 255);
+                        key = key * levels + static_cast<size_t>(mean * static_cast<float>(levels - 1) + 0.5f);
+                    }
+
+                    if (color_materials[key] < 0)
+                    {
+                        const auto level = [](const size_t q) { return static_cast<float>(q) / static_cast<float>(levels - 1); };
+
+                        color_materials[key] = static_cast<int>(obj.materials.size());
+                        obj.materials.emplace_back("vertex color", Vec3(level(key / (levels * levels)), level(key / levels % levels), level(key % levels)));
+                    }
+
+                    material = color_materials[key];
+                }
+
+                if (!issue)
+                {
+                    issue = obj.add_polygon(polygon, material);
+                }
+
+                // faces are numbered from 1 in place of lines
+                if (issue && !diagnostics.report(*issue, r + 1))
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (vertex)
+        {
+            vertex_count += element.count;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,12 @@
+/*
+ * ply.h
+ */
+
+#pragma once
+
+#include <string_view>
+
+#include "object.h"
+
+// appends vertices and faces of binary little endian ply to object, vertex colors become materials with color support
+bool load_ply(Object &obj, std::string_view text, bool color_support, Diagnostics &diagnostics);
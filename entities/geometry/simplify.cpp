@@ -0,0 +1,403 @@
+/*
+ * simplify.cpp
+ */
+
+#include "simplify.h"
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+#include "config.h"
+
+// helper classes
+
+// symmetric 4x4 error quadric - xx xy xz xw yy yz yw zz zw ww
+class Quadric {
+public:
+    double a[10] = {};
+
+    Quadric() = default;
+
+    // quadric of plane n * p + d = 0 with given weight
+    Quadric(const Vec3 &n, const double d, const double weight)
+    {
+        const double x = n.x, y = n.y, z = n.z;
+
+        a[0] = x * x * weight; a[1] = x * y * weight; a[2] = x * z * weight; a[3] = x * d * weight;
+        a[4] = y * y * weight; a[5] = y * z * weight; a[6] = y * d * weight;
+        a[7] = z * z * weight; a[8] = z * d * weight;
+        a[9] = d * d * weight;
+    }
+
+    Quadric &operator+=(const Quadric &other)
+    {
+        for (int i = 0; i < 10; i++)
+        {
+            a[i] += other.a[i];
+        }
+
+        return *this;
+    }
+
+    Quadric operator+(const Quadric &other) const
+    {
+        Quadric q = *this;
+        q += other;
+        return q;
+    }
+
+    // squared distance error of point
+    [[nodiscard]] double error(const Vec3 &v) const
+    {
+        const double x = v.x, y = v.y, z = v.z;
+
+        return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+             + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+             + a[7] * z * z + 2 * a[8] * z
+             + a[9];
+    }
+
+    // point of minimal error, fails for singular quadric
+    [[nodiscard]] std::optional<Vec3> optimum() const
+    {
+        const double det = a[0] * (a[4] * a[7] - a[5] * a[5]) - a[1] * (a[1] * a[7] - a[5] * a[2]) + a[2] * (a[1] * a[5] - a[4] * a[2]);
+        const double scale = a[0] * a[4] * a[7];
+
+        if (std::fabs(det) <= 1e-6 * std::fabs(scale) || std::fabs(det) < 1e-18)
+        {
+            return std::nullopt;
+        }
+
+        // cramer's rule for A p = -b
+        const double bx = -a[3], by = -a[6], bz = -a[8];
+
+        const double x = (bx * (a[4] * a[7] - a[5] * a[5]) - a[1] * (by * a[7] - a[5] * bz) + a[2] * (by * a[5] - a[4] * bz)) / det;
+        const double y = (a[0] * (by * a[7] - a[5] * bz) - bx * (a[1] * a[7] - a[5] * a[2]) + a[2] * (a[1] * bz - by * a[2])) / det;
+        const double z = (a[0] * (a[4] * bz - by * a[5]) - a[1] * (a[1] * bz - by * a[2]) + bx * (a[1] * a[5] - a[4] * a[2])) / det;
+
+        return Vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+    }
+};
+
+// candidate edge collapse
+class Collapse {
+public:
+    double cost;
+    unsigned int u, v;                  // u stays, v is removed
+    unsigned int stamp_u, stamp_v;      // vertex versions at time of evaluation
+    Vec3 target;                        // new position of u
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+// helper functions
+
+static uint64_t edge_key(unsigned int a, unsigned int b)
+{
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+// best position for merged vertices, optimum of quadric when it stays near edge, otherwise best of endpoints and midpoint
+static Collapse evaluate(const unsigned int u, const unsigned int v, const std::vector<Vec3> &positions, const std::vector<Quadric> &quadrics, const std::vector<unsigned int> &stamps)
+{
+    const Quadric q = quadrics[u] + quadrics[v];
+    const Vec3 &pu = positions[u];
+    const Vec3 &pv = positions[v];
+    const Vec3 mid = (pu + pv) * 0.5f;
+
+    Collapse best{q.error(pu), u, v, stamps[u], stamps[v], pu};
+
+    for (const Vec3 &p : {pv, mid})
+    {
+        if (const double e = q.error(p); e < best.cost)
+        {
+            best.cost = e;
+            best.target = p;
+        }
+    }
+
+    if (const auto opt = q.optimum(); opt && (*opt - mid).magnitude() <= (pu - pv).magnitude())
+    {
+        if (const double e = q.error(*opt); e < best.cost)
+        {
+            best.cost = e;
+            best.target = *opt;
+        }
+    }
+
+    best.cost = std::max(best.cost, 0.0);
+    return best;
+}
+
+// main functions
+
+Object simplify(const Object &obj, const size_t target_faces, const std::stop_token stop)
+{
+    const size_t vcount = obj.vertices.size();
+    const size_t fcount = obj.faces.size();
+
+    std::vector<Vec3> positions = obj.vertices;
+    std::vector<Quadric> quadrics(vcount);
+    std::vector<unsigned int> stamps(vcount, 0);
+    std::vector<bool> alive_vertex(vcount, true);
+
+    std::vector<std::array<unsigned int, 3>> tris(fcount);
+    std::vector<bool> alive_face(fcount, true);
+    std::vector<std::vector<unsigned int>> vertex_faces(vcount);
+
+    // plane quadrics weighted by face area
+    for (size_t i = 0; i < fcount; i++)
+    {
+        tris[i] = obj.faces[i].indices;
+
+        const Vec3 &p1 = positions[tris[i][0]];
+        const Vec3 cross = Vec3::cross(positions[tris[i][1]] - p1, positions[tris[i][2]] - p1);
+        const float area = cross.magnitude() * 0.5f;
+        const Vec3 n = cross.normalize();
+
+        const Quadric q(n, -Vec3::dot(n, p1), area);
+
+        for (const auto idx : tris[i])
+        {
+            quadrics[idx] += q;
+            vertex_faces[idx].push_back(static_cast<unsigned int>(i));
+        }
+    }
+
+    if (stop.stop_requested())
+    {
+        return {};
+    }
+
+    // edges with single face or faces of different materials get constraint planes
+    class EdgeInfo {
+    public:
+        unsigned int count = 0;
+        unsigned int face = 0;
+        bool border = false;
+    };
+
+    std::vector<int> face_material(fcount, -1);
+    for (const auto &range : obj.material_ranges)
+    {
+        std::fill_n(face_material.begin() + range.first, range.count, range.material);
+    }
+
+    std::unordered_map<uint64_t, EdgeInfo> edges;
+    edges.reserve(fcount * 2);
+
+    for (size_t i = 0; i < fcount; i++)
+    {
+        if (i % LOD_STOP_INTERVAL == 0 && stop.stop_requested())
+        {
+            return {};
+        }
+
+        for (int k = 0; k < 3; k++)
+        {
+            auto &e = edges[edge_key(tris[i][k], tris[i][(k + 1) % 3])];
+
+            if (e.count > 0 && face_material[e.face] != face_material[i])
+            {
+                e.border = true;
+            }
+
+            e.count++;
+            e.face = static_cast<unsigned int>(i);
+        }
+    }
+
+    if (stop.stop_requested())
+    {
+        return {};
+    }
+
+    for (const auto &[key, e] : edges)
+    {
+        if (e.count != 1 && !e.border)
+        {
+            continue;
+        }
+
+        const auto a = static_cast<unsigned int>(key >> 32);
+        const auto b = static_cast<unsigned int>(key & 0xffffffffu);
+
+        const auto &t = tris[e.face];
+        const Vec3 face_n = Vec3::cross(positions[t[1]] - positions[t[0]], positions[t[2]] - positions[t[0]]).normalize();
+        const Vec3 dir = positions[b] - positions[a];
+        const Vec3 n = Vec3::cross(dir, face_n).normalize();
+
+        const float length = dir.magnitude();
+        const Quadric q(n, -Vec3::dot(n, positions[a]), LOD_BORDER_WEIGHT * length * length);
+
+        quadrics[a] += q;
+        quadrics[b] += q;
+    }
+
+    // initial candidates
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> heap;
+    size_t pushed = 0;
+    for (const auto &[key, e] : edges)
+    {
+        if (++pushed % LOD_STOP_INTERVAL == 0 && stop.stop_requested())
+        {
+            return {};
+        }
+
+        heap.push(evaluate(static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key & 0xffffffffu), positions, quadrics, stamps));
+    }
+
+    edges.clear();
+
+    // collapsing cheapest edges
+    size_t live_faces = fcount;
+    std::vector<unsigned int> neighbours;
+
+    while (live_faces > target_faces && !heap.empty() && !stop.stop_requested())
+    {
+        const Collapse c = heap.top();
+        heap.pop();
+
+        if (!alive_vertex[c.u] || !alive_vertex[c.v] || stamps[c.u] != c.stamp_u || stamps[c.v] != c.stamp_v)
+        {
+            continue; // outdated candidate
+        }
+
+        // reject collapse that flips or degenerates surrounding faces
+        bool flips = false;
+        for (const auto moved : {c.u, c.v})
+        {
+            for (const auto fi : vertex_faces[moved])
+            {
+                const auto &t = tris[fi];
+                if (!alive_face[fi] || std::ranges::count(t, c.u) + std::ranges::count(t, c.v) == 2)
+                {
+                    continue;
+                }
+
+                std::array<Vec3, 3> p = {positions[t[0]], positions[t[1]], positions[t[2]]};
+                const Vec3 before = Vec3::cross(p[1] - p[0], p[2] - p[0]);
+
+                for (int k = 0; k < 3; k++)
+                {
+                    if (t[k] == moved)
+                    {
+                        p[k] = c.target;
+                    }
+                }
+
+                const Vec3 after = Vec3::cross(p[1] - p[0], p[2] - p[0]);
+                if (Vec3::dot(before.normalize(), after.normalize()) < 0.2f)
+                {
+                    flips = true;
+                    break;
+                }
+            }
+
+            if (flips)
+            {
+                break;
+            }
+        }
+
+        if (flips)
+        {
+            continue;
+        }
+
+        // merge v into u
+        positions[c.u] = c.target;
+        quadrics[c.u] += quadrics[c.v];
+        alive_vertex[c.v] = false;
+        stamps[c.u]++;
+
+        for (const auto fi : vertex_faces[c.v])
+        {
+            if (!alive_face[fi])
+            {
+                continue;
+            }
+
+            auto &t = tris[fi];
+            if (std::ranges::find(t, c.u) != t.end())
+            {
+                alive_face[fi] = false;
+                live_faces--;
+                continue;
+            }
+
+            std::ranges::replace(t, c.v, c.u);
+            vertex_faces[c.u].push_back(fi);
+        }
+
+        vertex_faces[c.v].clear();
+        std::erase_if(vertex_faces[c.u], [&alive_face](const unsigned int fi) { return !alive_face[fi]; });
+
+        // re-evaluate edges around merged vertex
+        neighbours.clear();
+        for (const auto fi : vertex_faces[c.u])
+        {
+            for (const auto idx : tris[fi])
+            {
+                if (idx != c.u)
+                {
+                    neighbours.push_back(idx);
+                }
+            }
+        }
+
+        std::ranges::sort(neighbours);
+        const auto [first, last] = std::ranges::unique(neighbours);
+        neighbours.erase(first, last);
+
+        for (const auto w : neighbours)
+        {
+            heap.push(evaluate(c.u, w, positions, quadrics, stamps));
+        }
+    }
+
+    if (stop.stop_requested())
+    {
+        return {};
+    }
+
+    // compact result
+    Object result;
+    result.materials = obj.materials;
+
+    std::vector<unsigned int> remap(vcount, std::numeric_limits<unsigned int>::max());
+    for (size_t i = 0; i < fcount; i++)
+    {
+        if (!alive_face[i])
+        {
+            continue;
+        }
+
+        std::array<unsigned int, 3> idx{};
+        for (int k = 0; k < 3; k++)
+        {
+            auto &r = remap[tris[i][k]];
+            if (r == std::numeric_limits<unsigned int>::max())
+            {
+                r = static_cast<unsigned int>(result.vertices.size());
+                result.vertices.push_back(positions[tris[i][k]]);
+            }
+            idx[k] = r;
+        }
+
+        result.add_face(idx[0], idx[1], idx[2], face_material[i]);
+    }
+
+    result.compute_normals();
+    result.build_meshlets();
+    result.optimize_cache();
+
+    return result;
+}
@@ -0,0 +1,10 @@
+/*
+ * simplify.h
+ */
+
+#pragma once
+
+#include "object.h"
+
+// quadric error metric edge collapse down to target face count, keeps open boundaries and material borders, empty on stop
+Object simplify(const Object &obj, size_t target_faces, std::stop_token stop = {});
@@ -0,0 +1,223 @@
+/*
+ * stl.cpp
+ */
+
+#include "stl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "utils/parallel.h"
+
+// binary layout, little endian
+static constexpr size_t HEADER_SIZE = 80 + 4;       // header text and triangle count
+static constexpr size_t TRIANGLE_SIZE = 50;         // normal, three corners and attribute
+static constexpr size_t CORNER_OFFSET = 12;         // corners follow normal
+
+// helper functions
+
+// bit patterns of position, negative zero equals zero
+static std::array<uint32_t, 3> position_bits(const Vec3 &p)
+{
+    return {std::bit_cast<uint32_t>(p.x + 0.0f), std::bit_cast<uint32_t>(p.y + 0.0f), std::bit_cast<uint32_t>(p.z + 0.0f)};
+}
+
+static uint64_t position_hash(const std::array<uint32_t, 3> &bits)
+{
+    uint64_t h = bits[0] * 0x9E3779B97F4A7C15ull ^ bits[1] * 0xC2B2AE3D27D4EB4Full ^ bits[2] * 0x165667B19E3779F9ull;
+    return h ^ (h >> 32);
+}
+
+// merges corners with equal positions into vertices and appends triangles of consecutive corner triples
+template <typename Corner>
+static void weld_corners(Object &obj, const size_t count, Corner &&corner)
+{
+    constexpr uint32_t empty = UINT32_MAX;
+
+    // open addressing table holding lowest corner index per position, filled by all threads at once
+    const size_t capacity = std::bit_ceil(count + count / 2 + 1);
+    const size_t mask = capacity - 1;
+
+    // uninitialized storage, parallel fill is the only pass before hashing
+    const auto table = std::make_unique_for_overwrite<uint32_t[]>(capacity);
+    parallel_for(capacity, [&](const size_t begin, const size_t end) {
+        std::fill(table.get() + begin, table.get() + end, empty);
+    });
+
+    const auto index = std::make_unique_for_overwrite<uint32_t[]>(count);  // table slot per corner, then vertex per corner
+    parallel_for(count, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const auto c = static_cast<uint32_t>(i);
+            const auto bits = position_bits(corner(i));
+
+            size_t h = position_hash(bits) & mask;
+            uint32_t v = std::atomic_ref(table[h]).load(std::memory_order_relaxed);
+
+            while (true)
+            {
+                if (v == empty)
+                {
+                    if (std::atomic_ref(table[h]).compare_exchange_strong(v, c, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                    continue; // v holds corner of other thread
+                }
+
+                // slot of same position keeps lowest corner index
+                if (position_bits(corner(v)) == bits)
+                {
+                    while (c < v && !std::atomic_ref(table[h]).compare_exchange_weak(v, c, std::memory_order_relaxed)) {}
+                    break;
+                }
+
+                h = (h + 1) & mask;
+                v = std::atomic_ref(table[h]).load(std::memory_order_relaxed);
+            }
+
+            index[i] = static_cast<uint32_t>(h);
+        }
+    });
+
+    // threads joined, plain reads from here on
+    // vertices in order of first corner, earlier corner already holds its vertex
+    obj.vertices.reserve(obj.vertices.size() + count / 3);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint32_t owner = table[index[i]];
+        if (owner == i)
+        {
+            index[i] = static_cast<uint32_t>(obj.vertices.size());
+            obj.add_vertex(corner(i));
+        }
+        else
+        {
+            index[i] = index[owner];
+        }
+    }
+
+    obj.faces.reserve(obj.faces.size() + count / 3);
+    for (size_t i = 0; i + 2 < count; i += 3)
+    {
+        obj.add_face(index[i], index[i + 1], index[i + 2], -1);
+    }
+}
+
+static Vec3 read_vec3(const char *p)
+{
+    float v[3];
+    std::memcpy(v, p, sizeof(v));
+    return {v[0], v[1], v[2]};
+}
+
+// corners read straight from mapped file
+static void load_binary(Object &obj, const std::string_view text, const size_t triangles)
+{
+    const char *data = text.data() + HEADER_SIZE;
+
+    weld_corners(obj, triangles * 3, [data](const size_t i) {
+        return read_vec3(data + (i / 3) * TRIANGLE_SIZE + CORNER_OFFSET + (i % 3) * sizeof(Vec3));
+    });
+}
+
+// solid, facet, outer loop, vertex x y z, endloop, endfacet, endsolid
+static bool load_ascii(Object &obj, std::string_view text, Diagnostics &diagnostics)
+{
+    std::vector<Vec3> corners;
+    std::vector<Vec3> facet;
+    bool facet_valid = true;    // no invalid vertex since facet start
+    size_t line_number = 0;
+
+    while (!text.empty())
+    {
+        std::string_view arguments = next_line(text);
+        const std::string_view cmd = next_token(arguments);
+        line_number++;
+
+        std::optional<LoadIssue> issue;
+
+        if (cmd == "vertex")
+        {
+            const auto x = parse_float(next_token(arguments));
+            const auto y = parse_float(next_token(arguments));
+            const auto z = parse_float(next_token(arguments));
+
+            facet.emplace_back(x.value_or(0.0f), y.value_or(0.0f), z.value_or(0.0f));
+
+            if (!x || !y || !z)
+            {
+                facet_valid = false;
+                issue = LoadIssue::InvalidVertex;
+            }
+        }
+        else if (cmd == "facet")
+        {
+            facet.clear();
+            facet_valid = true;
+        }
+        else if (cmd == "endfacet")
+        {
+            // facet with invalid vertex dropped, its corners would widen bounds
+            if (facet.size() != 3)
+            {
+                issue = LoadIssue::InvalidFacet;
+            }
+            else if (!facet_valid)
+            {
+                issue = LoadIssue::InvalidFaceVertex;
+            }
+            else
+            {
+                corners.insert(corners.end(), facet.begin(), facet.end());
+            }
+            facet.clear();
+            facet_valid = true;
+        }
+        // ignoring anything else
+
+        if (issue && !diagnostics.report(*issue, line_number))
+        {
+            return false;
+        }
+    }
+
+    weld_corners(obj, corners.size(), [&corners](const size_t i) { return corners[i]; });
+    return true;
+}
+
+bool load_stl(Object &obj, const std::string_view text, Diagnostics &diagnostics)
+{
+    // binary file size is given by triangle count, ascii file starts with solid
+    uint32_t triangles = 0;
+    if (text.size() >= HEADER_SIZE)
+    {
+        std::memcpy(&triangles, text.data() + 80, sizeof(triangles));
+    }
+
+    const bool sized = text.size() >= HEADER_SIZE && text.size() - HEADER_SIZE == static_cast<size_t>(triangles) * TRIANGLE_SIZE;
+
+    std::string_view head = text;
+    std::string_view first_line = next_line(head);
+    const bool ascii = next_token(first_line) == "solid";
+
+    if (sized || (!ascii && text.size() >= HEADER_SIZE + static_cast<size_t>(triangles) * TRIANGLE_SIZE))
+    {
+        load_binary(obj, text, triangles);
+        return true;
+    }
+
+    if (ascii)
+    {
+        return load_ascii(obj, text, diagnostics);
+    }
+
+    std::cerr << "error: invalid stl file" << std::endl;
+    return false;
+}
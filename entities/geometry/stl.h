@@ -0,0 +1,12 @@
+/*
+ * stl.h
+ */
+
+#pragma once
+
+#include <string_view>
+
+#include "object.h"
+
+// appends binary or ascii stl triangles to object, corners with equal positions become one vertex
+bool load_stl(Object &obj, std::string_view text, Diagnostics &diagnostics);
@@ -83,6 +83,10 @@ Buffer::Buffer(const unsigned int x, const unsigned int y, const float logical_x
 
     pixels.resize(x * y);
 
+    tiles_x = (x + DEPTH_TILE_X - 1) / DEPTH_TILE_X;
+    tiles_y = (y + DEPTH_TILE_Y - 1) / DEPTH_TILE_Y;
+    tiles.resize(tiles_x * tiles_y);
+
     clear();
 }
 
@@ -94,6 +98,18 @@ void Buffer::clear()
         p.c = ' ';
         p.material = std::nullopt;
     }
+
+    // border tiles hold fewer pixels
+    for (unsigned int ty = 0; ty < tiles_y; ty++)
+    {
+        const unsigned int h = std::min(DEPTH_TILE_Y, y - ty * DEPTH_TILE_Y);
+
+        for (unsigned int tx = 0; tx < tiles_x; tx++)
+        {
+            const unsigned int w = std::min(DEPTH_TILE_X, x - tx * DEPTH_TILE_X);
+            tiles[ty * tiles_x + tx] = DepthTile{std::numeric_limits<float>::max(), w * h};
+        }
+    }
 }
 
 int Buffer::index_x(const float real_x) const
@@ -128,18 +144,76 @@ float Buffer::depth(const Projection &projection, const Vec3 &normal, const int
     return z;
 }
 
-void Buffer::draw_projection(const Projection &projection, const char c, int material)
+bool Buffer::occluded(const float x_min, const float y_min, const float x_max, const float y_max, const float z) const
+{
+    const unsigned int tx_start = index_x(x_min) / DEPTH_TILE_X;
+    const unsigned int tx_end = index_x(x_max) / DEPTH_TILE_X;
+    const unsigned int ty_start = index_y(y_min) / DEPTH_TILE_Y;
+    const unsigned int ty_end = index_y(y_max) / DEPTH_TILE_Y;
+
+    for (unsigned int ty = ty_start; ty <= ty_end; ty++)
+    {
+        for (unsigned int tx = tx_start; tx <= tx_end; tx++)
+        {
+            if (tiles[ty * tiles_x + tx].max_z >= z)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void Buffer::fill_pixel(const int pixel_x, const int pixel_y)
+{
+    const unsigned int tx = pixel_x / DEPTH_TILE_X;
+    const unsigned int ty = pixel_y / DEPTH_TILE_Y;
+    DepthTile &tile = tiles[ty * tiles_x + tx];
+
+    if (--tile.empty > 0)
+    {
+        return;
+    }
+
+    // depths only decrease, so max at completion stays an upper bound
+    const unsigned int x_end = std::min(x, (tx + 1) * DEPTH_TILE_X);
+    const unsigned int y_end = std::min(y, (ty + 1) * DEPTH_TILE_Y);
+
+    float max_z = -std::numeric_limits<float>::max();
+    for (unsigned int py = ty * DEPTH_TILE_Y; py < y_end; py++)
+    {
+        for (unsigned int px = tx * DEPTH_TILE_X; px < x_end; px++)
+        {
+            max_z = std::max(max_z, pixels[py * x + px].z);
+        }
+    }
+
+    tile.max_z = max_z;
+}
+
+bool Buffer::draw_projection(const Projection &projection, const char c, int material)
 {
     const Projection triangle = projection.sort_x();
 
     const float x_i = triangle.p1.x + dx * 0.5f;
     const float x_f = triangle.p3.x - dx * 0.5f;
     if (x_f < 0.f || x_i > logical_x)
-        return;
+        return false;
+
+    // hierarchical depth test before rasterizing
+    const float y_min_t = std::min({triangle.p1.y, triangle.p2.y, triangle.p3.y});
+    const float y_max_t = std::max({triangle.p1.y, triangle.p2.y, triangle.p3.y});
+    const float z_min_t = std::min({triangle.p1.z, triangle.p2.z, triangle.p3.z});
+
+    if (occluded(x_i, y_min_t, x_f, y_max_t, z_min_t))
+        return false;
 
     const int x_start = index_x(x_i);
     const int x_end   = index_x(x_f);
 
+    bool drawn = false;
+
     const Vec3 normal = triangle.normal();
 
     for (int pixel_x = x_start; pixel_x <= x_end; pixel_x++)
@@ -167,12 +241,21 @@ void Buffer::draw_projection(const Projection &projection, const char c, int mat
 
             if (const float z = depth(triangle, normal, pixel_x, pixel_y); z < pixel.z)
             {
+                const bool empty = pixel.z == std::numeric_limits<float>::max();
+
                 pixel.z = z;
                 pixel.c = c;
                 pixel.material = material;
+
+                if (empty)
+                    fill_pixel(pixel_x, pixel_y);
+
+                drawn = true;
             }
         }
     }
+
+    return drawn;
 }
 
 void Buffer::printw() const
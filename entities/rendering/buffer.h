@@ -14,6 +14,7 @@
 
 #include "utils/mathematics.h"
 #include "utils/algorithms.h"
+#include "config.h"
 
 // screen pixel
 class Pixel {
@@ -40,6 +41,13 @@ public:
     [[nodiscard]] Vec3 normal() const;
 };
 
+// coarse depth of block of pixels
+class DepthTile {
+public:
+    float max_z;                // upper bound of pixel depths once tile is covered
+    unsigned int empty;         // pixels not yet drawn
+};
+
 // screen buffer
 class Buffer {
 public:
@@ -48,15 +56,23 @@ public:
     float dx, dy;               // logical character size
     std::vector<Pixel> pixels;  // pixel Buffer
 
+    unsigned int tiles_x, tiles_y;  // depth tile grid size
+    std::vector<DepthTile> tiles;   // coarse depth for early triangle rejection
+
     Buffer(unsigned int x, unsigned int y, float logical_x, float logical_y);
 
     void clear();
-    void draw_projection(const Projection &projection, char c, int material);
+    bool draw_projection(const Projection &projection, char c, int material);   // true if any pixel passed depth test
     void printw() const;
 
+    // true if logical rectangle lies behind every fully covered tile under it, z is nearest depth
+    [[nodiscard]] bool occluded(float x_min, float y_min, float x_max, float y_max, float z) const;
+
 private:
     [[nodiscard]] int index_x(float real_x) const;
     [[nodiscard]] int index_y(float real_y) const;
     [[nodiscard]] float depth(const Projection &projection, const Vec3 &normal, int pixel_x, int pixel_y) const;
 
+    void fill_pixel(int pixel_x, int pixel_y);
+
 };
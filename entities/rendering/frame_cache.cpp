@@ -0,0 +1,155 @@
+/*
+ * frame_cache.cpp
+ */
+
+#include "frame_cache.h"
+
+// CompressedFrame methods
+
+CompressedFrame CompressedFrame::compress(const Buffer &buf)
+{
+    CompressedFrame frame;
+
+    for (const auto &pixel : buf.pixels)
+    {
+        const auto material = static_cast<int16_t>(pixel.material.value_or(-1));
+
+        if (!frame.runs.empty())
+        {
+            if (Run &last = frame.runs.back(); last.c == pixel.c && last.material == material && last.length < UINT16_MAX)
+            {
+                last.length++;
+                continue;
+            }
+        }
+
+        frame.runs.emplace_back(pixel.c, material, 1);
+    }
+
+    frame.runs.shrink_to_fit();
+    return frame;
+}
+
+void CompressedFrame::restore(Buffer &buf) const
+{
+    size_t i = 0;
+
+    for (const auto &run : runs)
+    {
+        const std::optional<int> material = run.material >= 0 ? std::make_optional<int>(run.material) : std::nullopt;
+
+        for (uint16_t k = 0; k < run.length; k++, i++)
+        {
+            Pixel &pixel = buf.pixels[i];
+            pixel.z = std::numeric_limits<float>::max();
+            pixel.c = run.c;
+            pixel.material = material;
+        }
+    }
+}
+
+size_t CompressedFrame::bytes() const
+{
+    return runs.capacity() * sizeof(Run);
+}
+
+// FrameKey methods
+
+FrameKey::FrameKey(const Camera &cam, const Buffer &buf, const uint32_t flags) :
+    azimuth(static_cast<int32_t>(std::lround(rad2deg(cam.azimuth) * 100.0f))),
+    altitude(static_cast<int32_t>(std::lround(rad2deg(cam.altitude) * 100.0f))),
+    zoom(static_cast<int32_t>(std::lround(cam.zoom * 1000.0f))),
+    x(buf.x), y(buf.y), flags(flags) {}
+
+size_t FrameKeyHash::operator()(const FrameKey &key) const
+{
+    size_t h = 0;
+
+    for (const uint32_t v : {static_cast<uint32_t>(key.azimuth), static_cast<uint32_t>(key.altitude), static_cast<uint32_t>(key.zoom), key.x, key.y, key.flags})
+    {
+        h = h * 1000003u ^ v;
+    }
+
+    return h;
+}
+
+// FrameCache methods
+
+size_t FrameCache::entry_bytes(const CompressedFrame &frame)
+{
+    constexpr size_t overhead = sizeof(Entry) + 4 * sizeof(void *); // list node and index bucket
+    return frame.bytes() + overhead;
+}
+
+bool FrameCache::restore(const FrameKey &key, Buffer &buf)
+{
+    std::lock_guard lock(mutex);
+
+    const auto it = index.find(key);
+    if (it == index.end())
+    {
+        misses++;
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    it->second->second.restore(buf);
+
+    hits++;
+    return true;
+}
+
+void FrameCache::store(const FrameKey &key, const Buffer &buf)
+{
+    if (capacity == 0 || contains(key))
+    {
+        return;
+    }
+
+    CompressedFrame frame = CompressedFrame::compress(buf);
+    const size_t bytes = entry_bytes(frame);
+
+    if (bytes > capacity)
+    {
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+
+    if (index.contains(key))
+    {
+        return; // stored by other thread meanwhile
+    }
+
+    // evict least recently used frames
+    while (used + bytes > capacity && !entries.empty())
+    {
+        used -= entry_bytes(entries.back().second);
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+
+    entries.emplace_front(key, std::move(frame));
+    index.emplace(key, entries.begin());
+    used += bytes;
+}
+
+bool FrameCache::contains(const FrameKey &key) const
+{
+    std::lock_guard lock(mutex);
+    return index.contains(key);
+}
+
+size_t FrameCache::memory() const
+{
+    std::lock_guard lock(mutex);
+    return used;
+}
+
+float FrameCache::hit_rate() const
+{
+    std::lock_guard lock(mutex);
+
+    const size_t total = hits + misses;
+    return total > 0 ? static_cast<float>(hits) / static_cast<float>(total) : 0.0f;
+}
@@ -0,0 +1,84 @@
+/*
+ * frame_cache.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer.h"
+#include "entities/view/camera.h"
+
+// run of equal screen pixels
+class Run {
+public:
+    char c;                 // character
+    int16_t material;       // material index, -1 without material
+    uint16_t length;        // number of pixels
+
+    Run(const char c, const int16_t material, const uint16_t length) : c(c), material(material), length(length) {}
+};
+
+// run-length compressed buffer characters and materials, without depth
+class CompressedFrame {
+public:
+    std::vector<Run> runs;
+
+    [[nodiscard]] static CompressedFrame compress(const Buffer &buf);
+    void restore(Buffer &buf) const;
+
+    [[nodiscard]] size_t bytes() const;
+};
+
+// quantized view state identifying rendered frame
+class FrameKey {
+public:
+    int32_t azimuth;        // 0.01 deg
+    int32_t altitude;       // 0.01 deg
+    int32_t zoom;           // 0.001 x
+    uint32_t x, y;          // buffer size
+    uint32_t flags;         // render options
+
+    FrameKey(const Camera &cam, const Buffer &buf, uint32_t flags);
+
+    bool operator==(const FrameKey &other) const = default;
+};
+
+class FrameKeyHash {
+public:
+    size_t operator()(const FrameKey &key) const;
+};
+
+// least recently used cache of compressed frames with memory limit, shared with background rendering
+class FrameCache {
+public:
+    explicit FrameCache(size_t capacity_bytes) : capacity(capacity_bytes) {}
+
+    bool restore(const FrameKey &key, Buffer &buf);     // copies cached frame into buffer on hit
+    void store(const FrameKey &key, const Buffer &buf);
+
+    [[nodiscard]] bool contains(const FrameKey &key) const;  // lookup without counting hit or miss
+    [[nodiscard]] bool enabled() const { return capacity > 0; }
+
+    [[nodiscard]] float hit_rate() const;
+    [[nodiscard]] size_t memory() const;
+
+private:
+    using Entry = std::pair<FrameKey, CompressedFrame>;
+
+    size_t capacity;
+    size_t used = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    mutable std::mutex mutex;
+
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<FrameKey, std::list<Entry>::iterator, FrameKeyHash> index;
+
+    [[nodiscard]] static size_t entry_bytes(const CompressedFrame &frame);
+};
@@ -0,0 +1,103 @@
+/*
+ * prefetcher.cpp
+ */
+
+#include "prefetcher.h"
+
+Prefetcher::Prefetcher(const Object &obj, FrameCache &cache, const Light &light, const bool static_light, const bool color_support, const Backend backend) :
+    obj(obj), cache(cache), light(light), static_light(static_light), color_support(color_support), backend(backend),
+    flags((static_light ? 1u : 0u) | (color_support ? 2u : 0u)),
+    worker(&Prefetcher::run, this) {}
+
+Prefetcher::~Prefetcher()
+{
+    {
+        std::lock_guard lock(mutex);
+        quit = true;
+        stop = true;
+    }
+
+    wake.notify_one();
+    worker.join();
+}
+
+void Prefetcher::schedule(const Camera &cam, const Buffer &buf)
+{
+    {
+        std::lock_guard lock(mutex);
+        pending = PrefetchJob{cam, buf.x, buf.y, buf.logical_x, buf.logical_y};
+        stop = true;
+    }
+
+    wake.notify_one();
+}
+
+void Prefetcher::cancel()
+{
+    std::lock_guard lock(mutex);
+    pending.reset();
+    stop = true;
+}
+
+void Prefetcher::run()
+{
+    RenderContext ctx(obj);
+    ctx.abort = &stop;
+
+    std::optional<Buffer> buf;
+
+    while (true)
+    {
+        PrefetchJob job;
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this] { return quit || pending.has_value(); });
+
+            if (quit)
+            {
+                return;
+            }
+
+            job = *pending;
+            pending.reset();
+            stop = false;
+        }
+
+        if (!buf || buf->x != job.x || buf->y != job.y || buf->logical_x != job.logical_x)
+        {
+            buf.emplace(job.x, job.y, job.logical_x, job.logical_y);
+        }
+
+        // views reachable with single key press
+        std::array<Camera, 6> views;
+        views.fill(job.cam);
+        views[0].rotate_left();
+        views[1].rotate_right();
+        views[2].rotate_up();
+        views[3].rotate_down();
+        views[4].zoom_in();
+        views[5].zoom_out();
+
+        for (const auto &view : views)
+        {
+            if (stop)
+            {
+                break;
+            }
+
+            const FrameKey key(view, *buf, flags);
+            if (cache.contains(key))
+            {
+                continue;
+            }
+
+            buf->clear();
+            Renderer::render(ctx, *buf, obj, view, light, static_light, color_support, backend);
+
+            if (!stop)
+            {
+                cache.store(key, *buf);
+            }
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * prefetcher.h
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "frame_cache.h"
+#include "renderer.h"
+
+// view to speculate around
+class PrefetchJob {
+public:
+    Camera cam;
+    unsigned int x, y;              // buffer size
+    float logical_x, logical_y;     // logical buffer size
+};
+
+// renders views one step away from current camera in background and stores them in frame cache
+class Prefetcher {
+public:
+    Prefetcher(const Object &obj, FrameCache &cache, const Light &light, bool static_light, bool color_support, Backend backend);
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+
+    void schedule(const Camera &cam, const Buffer &buf);    // replaces pending work with neighbours of camera
+    void cancel();                                          // abandons current work immediately
+
+private:
+    const Object &obj;
+    FrameCache &cache;
+    const Light &light;
+    bool static_light;
+    bool color_support;
+    Backend backend;
+    uint32_t flags;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::optional<PrefetchJob> pending;
+    bool quit = false;
+    std::atomic<bool> stop{false};  // aborts render in progress
+
+    std::thread worker;
+
+    void run();
+};
@@ -4,55 +4,328 @@
 
 #include "renderer.h"
 
-char Renderer::luminance_char(const Vec3 &normal, const Vec3 &light, const std::string &scale)
+// RenderContext methods
+
+void RenderContext::reserve(const Object &obj)
+{
+    size_t vcount = obj.vertex_count();
+    size_t mcount = obj.meshlets.size();
+    for (const auto &level : obj.levels())
+    {
+        vcount = std::max(vcount, level.vertex_count());
+        mcount = std::max(mcount, level.meshlets.size());
+    }
+
+    if (sverts.size() < vcount)
+    {
+        sverts.resize(vcount);
+        stamps.assign(vcount, 0);
+    }
+
+    order.reserve(mcount);
+    visible.reserve(mcount);
+
+    // threads for point loops started before first frame, ray loops start them on first cast
+    if (obj.point_cloud())
+    {
+        extremes.reserve(pool().size());
+    }
+
+    shade_cache(obj);
+    for (const auto &level : obj.levels())
+    {
+        shade_cache(level);
+    }
+}
+
+WorkerPool &RenderContext::pool()
+{
+    if (!workers)
+    {
+        workers = std::make_unique<WorkerPool>(threads ? threads : worker_count());
+    }
+
+    return *workers;
+}
+
+ShadeCache &RenderContext::shade_cache(const Object &lod)
+{
+    auto it = std::ranges::find_if(shades, [&lod](const ShadeCache &c) { return c.obj == &lod; });
+    if (it == shades.end())
+    {
+        it = shades.insert(shades.end(), ShadeCache{});
+        it->obj = &lod;
+    }
+
+    if (it->chars.size() != lod.faces.size())
+    {
+        it->chars.resize(lod.faces.size());
+        it->valid = false;
+    }
+
+    return *it;
+}
+
+// Renderer methods
+
+// luminance ramp indexed by cosine quantized to LUMINANCE_LEVELS steps
+static constexpr auto LUMINANCE_TABLE = [] {
+    constexpr int ramp = static_cast<int>(sizeof(CHARS_LUM)) - 2;  // last ramp index, without terminator
+
+    std::array<char, LUMINANCE_LEVELS> table{};
+    for (size_t i = 0; i < LUMINANCE_LEVELS; i++)
+    {
+        const float sim = static_cast<float>(i) / static_cast<float>(LUMINANCE_LEVELS - 1);
+        table[i] = CHARS_LUM[static_cast<int>(sim * static_cast<float>(ramp) + 0.5f)];
+    }
+
+    return table;
+}();
+
+char Renderer::luminance_char(const float cosine)
+{
+    constexpr float scale = 0.5f * static_cast<float>(LUMINANCE_LEVELS - 1);
+    const int idx = static_cast<int>((cosine + 1.0f) * scale + 0.5f);
+    return LUMINANCE_TABLE[std::clamp(idx, 0, static_cast<int>(LUMINANCE_LEVELS) - 1)];
+}
+
+const std::vector<char> &Renderer::static_luminance(RenderContext &ctx, const Object &lod, const Light &light)
+{
+    ShadeCache &cache = ctx.shade_cache(lod);
+
+    const Vec3 &ld = light.direction;
+    if (cache.valid && cache.light.x == ld.x && cache.light.y == ld.y && cache.light.z == ld.z)
+    {
+        return cache.chars;
+    }
+
+    for (size_t i = 0; i < lod.faces.size(); i++)
+    {
+        cache.chars[i] = luminance_char(Vec3::dot(lod.normals[i], ld));
+    }
+
+    cache.light = ld;
+    cache.valid = true;
+
+    return cache.chars;
+}
+
+float Renderer::covered_cells(const Object &obj, const Buffer &buf, const Camera &cam)
 {
-    const float sim = (Vec3::cosine_similarity(normal, light) + 1.0f) * 0.5f;
-    const int idx = std::clamp(static_cast<int>(std::round(sim * static_cast<float>(scale.size() - 1))), 0, static_cast<int>(scale.size() - 1));
-    return scale[idx];
+    // bounding radius of object from meshlet spheres
+    float radius = 0.0f;
+    for (const auto &m : obj.meshlets)
+    {
+        radius = std::max(radius, m.center.magnitude() + m.radius);
+    }
+
+    const float r = 0.5f * radius * cam.zoom;
+    return std::min(PI * r * r / (buf.dx * buf.dy), static_cast<float>(buf.x * buf.y));
 }
 
-void Renderer::render(Buffer &buf, const Object &obj, const Camera &cam, const Light  &light, bool static_light, bool color_support)
+const Object &Renderer::select_lod(const Object &obj, const Buffer &buf, const Camera &cam)
+{
+    const float wanted = covered_cells(obj, buf, cam) * LOD_FACES_PER_PIXEL;
+
+    // levels built in background once coarser one would be picked, full detail drawn meanwhile
+    if (static_cast<float>(obj.faces.size() / 2) < wanted || obj.faces.size() / 2 < LOD_MIN_FACES)
+    {
+        return obj;
+    }
+
+    obj.request_lods(static_cast<size_t>(static_cast<float>(buf.x * buf.y) * LOD_FACES_PER_PIXEL));
+
+    const Object *pick = &obj;
+    for (const auto &level : obj.levels())
+    {
+        if (static_cast<float>(level.faces.size()) < wanted)
+        {
+            break;
+        }
+
+        pick = &level;
+    }
+
+    return *pick;
+}
+
+void Renderer::render(RenderContext &ctx, Buffer &buf, const Object &obj, const Camera &cam, const Light  &light, bool static_light, bool color_support, const Backend backend)
+{
+    if (obj.point_cloud())
+    {
+        splat(ctx, buf, obj, cam);
+        return;
+    }
+
+    const Object &lod = select_lod(obj, buf, cam);
+
+    // rays pay off once even coarsest level is much denser than screen, hierarchy needs float positions
+    // not decided while levels are building, first frames would pay for hierarchy of too dense level
+    bool rays = backend == Backend::RayCast;
+    if (backend == Backend::Auto && obj.faces.size() >= RAYCAST_MIN_FACES && obj.lod_state() != LodState::Building)
+    {
+        rays = static_cast<float>(lod.faces.size()) > covered_cells(obj, buf, cam) * RAYCAST_FACES_PER_PIXEL;
+    }
+
+    if (rays && !obj.compacted())
+    {
+        if (static_light)
+        {
+            color_support ? cast<true, true>(ctx, buf, obj, cam, light) : cast<true, false>(ctx, buf, obj, cam, light);
+        }
+        else
+        {
+            color_support ? cast<false, true>(ctx, buf, obj, cam, light) : cast<false, false>(ctx, buf, obj, cam, light);
+        }
+
+        return;
+    }
+
+    // options resolved once per frame
+    if (static_light)
+    {
+        color_support ? draw<true, true>(ctx, buf, lod, cam, light) : draw<true, false>(ctx, buf, lod, cam, light);
+    }
+    else
+    {
+        color_support ? draw<false, true>(ctx, buf, lod, cam, light) : draw<false, false>(ctx, buf, lod, cam, light);
+    }
+}
+
+std::array<Vec3, 3> Renderer::view_rows(const Camera &cam)
 {
     const float az_cos = std::cos(cam.azimuth);
     const float az_sin = std::sin(cam.azimuth);
     const float al_cos = std::cos(cam.altitude);
     const float al_sin = std::sin(cam.altitude);
 
-    // pre-computed rotations
-    auto rot_y = [az_cos, az_sin](const Vec3 &v) {
-        return Vec3::rotate_y(v, std::atan2(-az_sin, az_cos));
+    // equal to rotate_x(rotate_y(v, -azimuth), -altitude)
+    return {
+        Vec3(az_cos, 0.0f, az_sin),
+        Vec3(-al_sin * az_sin, al_cos, al_sin * az_cos),
+        Vec3(-al_cos * az_sin, -al_sin, al_cos * az_cos)
     };
+}
 
-    auto rot_x = [al_cos, al_sin](const Vec3 &v) {
-        return Vec3::rotate_x(v, std::atan2(-al_sin, al_cos));
-    };
+template <bool StaticLight, bool Color>
+void Renderer::draw(RenderContext &ctx, Buffer &buf, const Object &lod, const Camera &cam, const Light &light)
+{
+    const auto [row_x, row_y, row_z] = view_rows(cam);
 
     const float lx = buf.logical_x;
     const float ly = buf.logical_y;
 
+    auto rotate = [&row_x, &row_y, &row_z](const Vec3 &v) {
+        return Vec3(Vec3::dot(row_x, v), Vec3::dot(row_y, v), Vec3::dot(row_z, v));
+    };
+
+    // compact vertices are dequantized by rows scaled once per frame
+    const bool quantized = lod.compacted();
+    const float qs = quantized ? lod.qscale : 1.0f;
+    const Vec3 qrow_x = row_x * qs;
+    const Vec3 qrow_y = row_y * qs;
+    const Vec3 qrow_z = row_z * qs;
+
+    auto project = [&](const size_t i) {
+        const Vec3 v = quantized ? Vec3(lod.qvertices[i].x, lod.qvertices[i].y, lod.qvertices[i].z) : lod.vertices[i];
+        return Vec3::to_screen(Vec3(Vec3::dot(qrow_x, v), Vec3::dot(qrow_y, v), Vec3::dot(qrow_z, v)), cam.zoom, lx, ly);
+    };
+
+    // static light shading is cached per face, view light is rotated back into object space
+    const Vec3 &ld = light.direction;
+    const Vec3 light_obj = -(row_x * ld.x + row_y * ld.y + row_z * ld.z);
+
+    const char *face_lum = nullptr;
+    if constexpr (StaticLight)
+    {
+        face_lum = static_luminance(ctx, lod, light).data();
+    }
+
     // first pass - rotate, project, collect bounds
-    const size_t vcount = obj.vertices.size();
+    const size_t vcount = lod.vertex_count();
+
+    if (ctx.sverts.size() < vcount)
+    {
+        ctx.reserve(lod);
+    }
 
-    std::vector<Vec3> rverts(vcount);   // rotated vertices
-    std::vector<Vec3> sverts(vcount);   // screen coords (without offset)
+    std::vector<Vec3> &sverts = ctx.sverts;
 
-    float min_x = std::numeric_limits<float>::max();
-    float max_x = -std::numeric_limits<float>::max();
     float min_y = std::numeric_limits<float>::max();
     float max_y = -std::numeric_limits<float>::max();
 
-    for (size_t i = 0; i < vcount; i++)
+    // with occlusion culling only vertices of clusters that are drawn or may hold bounds are projected
+    const bool lazy = ctx.occlusion && !lod.meshlets.empty();
+
+    if (!lazy)
     {
-        const Vec3 rv = rot_x(rot_y(obj.vertices[i]));
-        rverts[i] = rv;
+        for (size_t i = 0; i < vcount; i++)
+        {
+            if ((i & 0xffff) == 0 && ctx.aborted())
+            {
+                return;
+            }
 
-        const Vec3 sv = Vec3::to_screen(rv, cam.zoom, lx, ly);
-        sverts[i] = sv;
+            const Vec3 sv = project(i);
+            sverts[i] = sv;
 
-        min_x = std::min(min_x, sv.x);
-        max_x = std::max(max_x, sv.x);
-        min_y = std::min(min_y, sv.y);
-        max_y = std::max(max_y, sv.y);
+            min_y = std::min(min_y, sv.y);
+            max_y = std::max(max_y, sv.y);
+        }
+    }
+    else if (++ctx.frame == 0)
+    {
+        std::ranges::fill(ctx.stamps, 0);
+        ctx.frame = 1;
+    }
+
+    const uint32_t frame = ctx.frame;
+    std::vector<uint32_t> &stamps = ctx.stamps;
+
+    auto vertex = [&](const unsigned int idx) -> const Vec3 & {
+        if (lazy && stamps[idx] != frame)
+        {
+            sverts[idx] = project(idx);
+            stamps[idx] = frame;
+        }
+
+        return sverts[idx];
+    };
+
+    if (lazy)
+    {
+        // screen space bounding sphere of cluster, y grows downwards
+        auto bounds_y = [&](const Meshlet &m) {
+            const float cy = Vec3::to_screen(rotate(m.center), cam.zoom, lx, ly).y;
+            const float ry = 0.5f * m.radius * cam.zoom;
+            return std::pair(cy - ry, cy + ry);
+        };
+
+        auto project_meshlet = [&](const Meshlet &m) {
+            for (unsigned int i = m.first; i < m.first + m.count; i++)
+            {
+                for (const unsigned int idx : lod.faces[i].indices)
+                {
+                    const float y = vertex(idx).y;
+                    min_y = std::min(min_y, y);
+                    max_y = std::max(max_y, y);
+                }
+            }
+        };
+
+        // start from clusters reaching furthest, then visit only clusters able to extend bounds
+        const auto top = std::ranges::min_element(lod.meshlets, {}, [&](const Meshlet &m) { return bounds_y(m).first; });
+        const auto bottom = std::ranges::max_element(lod.meshlets, {}, [&](const Meshlet &m) { return bounds_y(m).second; });
+        project_meshlet(*top);
+        project_meshlet(*bottom);
+
+        for (const auto &m : lod.meshlets)
+        {
+            if (const auto [lo, hi] = bounds_y(m); lo < min_y || hi > max_y)
+            {
+                project_meshlet(m);
+            }
+        }
     }
 
     // offset that centers the bounding box in logical space
@@ -60,32 +333,380 @@ void Renderer::render(Buffer &buf, const Object &obj, const Camera &cam, const L
     const float off_y = (ly - (max_y - min_y)) * 0.5f - min_y;
     const Vec3 offset(off_x, off_y, 0.0f);
 
-    // second pass - draw faces
-    for (const auto &face : obj.faces)
+    // second pass - draw faces of meshlets facing camera, returns whether any pixel was drawn
+    auto draw_faces = [&](const unsigned int first, const unsigned int count, const int range_material) {
+        bool drawn = false;
+
+        // material is shared by whole range
+        int material = -1;
+        if constexpr (Color)
+        {
+            material = range_material;
+        }
+
+        for (unsigned int i = first; i < first + count; i++)
+        {
+            const Face &face = lod.faces[i];
+            const Vec3 &normal = lod.normals[i];
+
+            // back-face culling in camera space
+            if (Vec3::dot(row_z, normal) >= 0.0f)
+            {
+                continue;
+            }
+
+            // screen coordinates with centering offset
+            const Vec3 s1 = vertex(face.indices[0]) + offset;
+            const Vec3 s2 = vertex(face.indices[1]) + offset;
+            const Vec3 s3 = vertex(face.indices[2]) + offset;
+
+            // shading
+            char lum;
+            if constexpr (StaticLight)
+            {
+                lum = face_lum[i];
+            }
+            else
+            {
+                lum = luminance_char(Vec3::dot(normal, light_obj));
+            }
+
+            drawn |= buf.draw_projection(Projection(s1, s2, s3, lum), lum, material);
+        }
+
+        return drawn;
+    };
+
+    if (lod.meshlets.empty())
+    {
+        for (const auto &range : lod.material_ranges)
+        {
+            draw_faces(range.first, range.count, range.material);
+        }
+        return;
+    }
+
+    // front facing clusters ordered front to back, so depth tiles fill before hidden geometry
+    std::vector<std::pair<float, unsigned int>> &order = ctx.order;
+    order.clear();
+
+    for (unsigned int i = 0; i < lod.meshlets.size(); i++)
+    {
+        const Meshlet &m = lod.meshlets[i];
+
+        // whole cluster back-facing, camera looks along +z in camera space
+        if (Vec3::dot(row_z, m.cone_axis) >= m.cone_cutoff)
+        {
+            if (lazy && ctx.visible_lod == &lod)
+                ctx.visible[i] = 0;
+
+            continue;
+        }
+
+        order.emplace_back(Vec3::dot(row_z, m.center) - m.radius, i);
+    }
+
+    std::ranges::sort(order);
+
+    if (!lazy)
+    {
+        for (const auto &[near, i] : order)
+        {
+            if (ctx.aborted())
+            {
+                return;
+            }
+
+            const Meshlet &m = lod.meshlets[i];
+            draw_faces(m.first, m.count, m.material);
+        }
+
+        return;
+    }
+
+    // visibility of previous frame applies only to same level of detail
+    enum : uint8_t { HIDDEN, VISIBLE, REJECTED };   // rejected clusters were drawn in first pass without any pixel
+
+    std::vector<uint8_t> &visible = ctx.visible;
+    if (ctx.visible_lod != &lod)
+    {
+        visible.assign(lod.meshlets.size(), HIDDEN);
+        ctx.visible_lod = &lod;
+    }
+
+    // first pass - clusters visible last frame build occluders
+    for (const auto &[near, i] : order)
+    {
+        if (ctx.aborted())
+        {
+            return;
+        }
+
+        if (visible[i] == VISIBLE)
+        {
+            const Meshlet &m = lod.meshlets[i];
+            visible[i] = draw_faces(m.first, m.count, m.material) ? VISIBLE : REJECTED;
+        }
+    }
+
+    // second pass - newly visible clusters, bounding sphere tested against depth tiles
+    for (const auto &[near, i] : order)
     {
-        const Vec3 &rv1 = rverts[face.indices[0]];
-        const Vec3 &rv2 = rverts[face.indices[1]];
-        const Vec3 &rv3 = rverts[face.indices[2]];
+        if (ctx.aborted())
+        {
+            return;
+        }
+
+        if (visible[i] != HIDDEN)
+        {
+            visible[i] = visible[i] == VISIBLE ? VISIBLE : HIDDEN;
+            continue;
+        }
 
-        // back-face culling in camera space
-        Vec3 normal_cam = Vec3::cross(rv2 - rv1, rv3 - rv1).normalize();
+        const Meshlet &m = lod.meshlets[i];
+        const Vec3 c = Vec3::to_screen(rotate(m.center), cam.zoom, lx, ly) + offset;
+        const float r = 0.5f * m.radius * cam.zoom;
 
-        if (normal_cam.z >= 0.0f)
+        if (buf.occluded(c.x - r, c.y - r, c.x + r, c.y + r, c.z - r))
         {
             continue;
         }
 
-        const Vec3 normal_view = -normal_cam;
+        visible[i] = draw_faces(m.first, m.count, m.material) ? VISIBLE : HIDDEN;
+    }
+}
 
-        // screen coordinates with centering offset
-        const Vec3 s1 = sverts[face.indices[0]] + offset;
-        const Vec3 s2 = sverts[face.indices[1]] + offset;
-        const Vec3 s3 = sverts[face.indices[2]] + offset;
+template <bool StaticLight, bool Color>
+void Renderer::cast(RenderContext &ctx, Buffer &buf, const Object &obj, const Camera &cam, const Light &light)
+{
+    // camera axes in object space, rays run along row_z
+    const auto [row_x, row_y, row_z] = view_rows(cam);
 
-        // shading
-        const Vec3 n_light = static_light ? Vec3::cross(obj.vertices[face.indices[1]] - obj.vertices[face.indices[0]], obj.vertices[face.indices[2]] - obj.vertices[face.indices[0]]).normalize() : normal_view;
-        const char lum = luminance_char(n_light, light.direction, CHARS_LUM);
+    const Vec3 &ld = light.direction;
+    const Vec3 light_obj = -(row_x * ld.x + row_y * ld.y + row_z * ld.z);
 
-        buf.draw_projection(Projection(s1, s2, s3, lum), lum, (color_support && face.material) ? *face.material : -1);
+    const char *face_lum = nullptr;
+    if constexpr (StaticLight)
+    {
+        face_lum = static_luminance(ctx, obj, light).data();
     }
-}
\ No newline at end of file
+
+    const float lx = buf.logical_x;
+    const float ly = buf.logical_y;
+
+    // built by first frame that needs it, read only through synchronized accessor
+    const Bvh &bvh = obj.hierarchy();
+
+    // same centering as rasterizer, from extremes of projected vertices
+    const auto [lo, hi] = bvh.extent(obj, row_y);
+    const float min_y = 0.5f * ly - 0.5f * hi * cam.zoom;
+    const float max_y = 0.5f * ly - 0.5f * lo * cam.zoom;
+    const float off_y = (ly - (max_y - min_y)) * 0.5f - min_y;
+
+    // inverse of screen transform
+    const float scale = 2.0f / cam.zoom;
+
+    ctx.pool().run(buf.y, [&](const size_t begin, const size_t end) {
+        for (size_t py = begin; py < end; py++)
+        {
+            if (ctx.aborted())
+            {
+                return;
+            }
+
+            const float sy = (static_cast<float>(py) + 0.5f) * buf.dy - off_y;
+            const Vec3 origin_y = row_y * ((0.5f * ly - sy) * scale);
+
+            for (unsigned int px = 0; px < buf.x; px++)
+            {
+                const float sx = (static_cast<float>(px) + 0.5f) * buf.dx;
+                const Vec3 origin = origin_y + row_x * ((sx - 0.5f * lx) * scale);
+
+                float t;
+                unsigned int f;
+                if (!bvh.intersect(obj, origin, row_z, t, f))
+                {
+                    continue;
+                }
+
+                char lum;
+                if constexpr (StaticLight)
+                {
+                    lum = face_lum[f];
+                }
+                else
+                {
+                    lum = luminance_char(Vec3::dot(obj.normals[f], light_obj));
+                }
+
+                int material = -1;
+                if constexpr (Color)
+                {
+                    material = obj.face_material(f);
+                }
+
+                Pixel &pixel = buf.pixels[py * buf.x + px];
+                pixel.z = (t * cam.zoom + 1.0f) * 0.5f;
+                pixel.c = lum;
+                pixel.material = material;
+            }
+        }
+    });
+}
+
+void Renderer::splat(RenderContext &ctx, Buffer &buf, const Object &obj, const Camera &cam)
+{
+    // rotation rows and screen transform folded into per axis factors
+    const float lx = buf.logical_x;
+    const float ly = buf.logical_y;
+    const float half = 0.5f * cam.zoom * (obj.compacted() ? obj.qscale : 1.0f);  // dequantization folded in
+
+    const auto [row_x, row_y, row_z] = view_rows(cam);
+    const float xx = row_x.x * half, xz = row_x.z * half;
+    const float yx = row_y.x * half, yy = row_y.y * half, yz = row_y.z * half;
+    const float zx = row_z.x * half, zy = row_z.y * half, zz = row_z.z * half;
+
+    const size_t vcount = obj.vertex_count();
+    const size_t cells = static_cast<size_t>(buf.x) * buf.y;
+    WorkerPool &pool = ctx.pool();
+    const size_t slots = std::min<size_t>(pool.size(), std::max<size_t>(1, vcount));
+    const size_t chunk = (vcount + slots - 1) / slots;
+
+    // visits positions of vertices in range, storage checked once per range instead of per point
+    auto for_points = [&obj](const size_t begin, const size_t end, auto &&fn) {
+        if (obj.compacted())
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                const QVertex &q = obj.qvertices[i];
+                fn(static_cast<float>(q.x), static_cast<float>(q.y), static_cast<float>(q.z));
+            }
+        }
+        else
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                const Vec3 &v = obj.vertices[i];
+                fn(v.x, v.y, v.z);
+            }
+        }
+    };
+
+    // first pass - vertical extremes for same centering as faces
+    std::vector<std::pair<float, float>> &extremes = ctx.extremes;
+    extremes.resize(slots);
+
+    pool.run(slots, [&](const size_t begin, const size_t end) {
+        for (size_t s = begin; s < end; s++)
+        {
+            float lo = std::numeric_limits<float>::max();
+            float hi = -std::numeric_limits<float>::max();
+
+            for_points(s * chunk, std::min(vcount, (s + 1) * chunk), [&](const float x, const float y, const float z) {
+                const float py = yx * x + yy * y + yz * z;
+                lo = std::min(lo, py);
+                hi = std::max(hi, py);
+            });
+
+            extremes[s] = {lo, hi};
+        }
+    });
+
+    float lo = std::numeric_limits<float>::max();
+    float hi = -std::numeric_limits<float>::max();
+    for (const auto &[l, h] : extremes)
+    {
+        lo = std::min(lo, l);
+        hi = std::max(hi, h);
+    }
+
+    // screen y is flipped, middle of projected range lands on middle of screen
+    const float cy = 0.5f * ly + 0.5f * (lo + hi);
+    const float cx = 0.5f * lx;
+
+    const float inv_dx = 1.0f / buf.dx;
+    const float inv_dy = 1.0f / buf.dy;
+    const auto width = static_cast<float>(buf.x);
+    const auto height = static_cast<float>(buf.y);
+
+    if (ctx.splats.size() != slots * cells)
+    {
+        ctx.splats.resize(slots * cells);
+    }
+
+    // second pass - nearest depth and count per cell, separate screen per worker
+    pool.run(slots, [&](const size_t begin, const size_t end) {
+        for (size_t s = begin; s < end; s++)
+        {
+            SplatCell *screen = ctx.splats.data() + s * cells;
+            std::fill(screen, screen + cells, SplatCell{std::numeric_limits<float>::max(), 0});
+
+            const size_t last = std::min(vcount, (s + 1) * chunk);
+
+            for (size_t block = s * chunk; block < last; block += 0x10000)
+            {
+                if (ctx.aborted())
+                {
+                    return;
+                }
+
+                for_points(block, std::min(last, block + 0x10000), [&](const float x, const float y, const float z) {
+                    // position in cells
+                    const float sx = (cx + xx * x + xz * z) * inv_dx;
+                    const float sy = (cy - (yx * x + yy * y + yz * z)) * inv_dy;
+
+                    if (sx < 0.0f || sy < 0.0f || sx >= width || sy >= height)
+                    {
+                        return;
+                    }
+
+                    SplatCell &cell = screen[static_cast<size_t>(sy) * buf.x + static_cast<size_t>(sx)];
+                    cell.z = std::min(cell.z, zx * x + zy * y + zz * z);
+                    cell.count++;
+                });
+            }
+        }
+    });
+
+    if (ctx.aborted())
+    {
+        return;
+    }
+
+    // merge worker screens into first one
+    unsigned int densest = 0;
+    for (size_t c = 0; c < cells; c++)
+    {
+        SplatCell &cell = ctx.splats[c];
+
+        for (size_t s = 1; s < slots; s++)
+        {
+            const SplatCell &other = ctx.splats[s * cells + c];
+            cell.z = std::min(cell.z, other.z);
+            cell.count += other.count;
+        }
+
+        densest = std::max(densest, cell.count);
+    }
+
+    // denser cells are brighter, logarithmic so sparse regions stay visible
+    const float norm = 1.0f / std::log(1.0f + static_cast<float>(densest));
+
+    for (size_t c = 0; c < cells; c++)
+    {
+        const SplatCell &cell = ctx.splats[c];
+        if (cell.count == 0)
+        {
+            continue;
+        }
+
+        Pixel &pixel = buf.pixels[c];
+        if (const float z = cell.z + 0.5f; z < pixel.z)
+        {
+            const float density = std::log(1.0f + static_cast<float>(cell.count)) * norm;
+            pixel.z = z;
+            pixel.c = luminance_char(2.0f * density - 1.0f);
+            pixel.material = -1;
+        }
+    }
+}
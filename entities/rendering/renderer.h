@@ -4,19 +4,102 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+
 #include "buffer.h"
 #include "entities/geometry/object.h"
 #include "entities/view/camera.h"
 #include "entities/view/light.h"
 #include "utils/algorithms.h"
+#include "utils/parallel.h"
 #include "config.h"
 
+// face luminance under static light, depends only on geometry and light direction
+class ShadeCache {
+public:
+    const Object *obj = nullptr;    // shaded level of detail
+    Vec3 light;                     // light direction used for shading
+    bool valid = false;
+    std::vector<char> chars;        // luminance character per face
+};
+
+// nearest point and number of points projected into screen cell
+class SplatCell {
+public:
+    float z;
+    unsigned int count;
+};
+
+// frame scratch storage reused between frames, sized once per model
+class RenderContext {
+public:
+    std::vector<Vec3> sverts;       // screen coords of vertices (without offset)
+    std::vector<ShadeCache> shades; // static light luminance per level of detail
+    std::vector<std::pair<float, unsigned int>> order;  // meshlets by nearest depth, front to back
+
+    bool occlusion = false;             // skip clusters hidden behind clusters visible in previous frame
+    uint32_t frame = 0;                 // current frame number for lazy projection
+    std::vector<uint32_t> stamps;       // frame in which vertex was last projected
+    const Object *visible_lod = nullptr;    // level of detail previous frame visibility refers to
+    std::vector<uint8_t> visible;       // meshlets that drew any pixel in previous frame
+    std::vector<SplatCell> splats;      // point cloud cells, one screen per worker
+    std::vector<std::pair<float, float>> extremes;  // point cloud vertical bounds per worker
+
+    const std::atomic<bool> *abort = nullptr;   // frame is abandoned as soon as flag is set
+    unsigned int threads = 0;           // threads of parallel loops inside frame, 0 for all hardware threads
+
+    RenderContext() = default;
+    explicit RenderContext(const Object &obj) { reserve(obj); }
+
+    void reserve(const Object &obj);    // size for object and all its levels of detail
+
+    ShadeCache &shade_cache(const Object &lod);
+    WorkerPool &pool();                 // started on first use, kept for all following frames
+
+    [[nodiscard]] bool aborted() const { return abort && abort->load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<WorkerPool> workers;
+};
+
+// way of turning faces into pixels
+enum class Backend {
+    Raster,     // project and fill every front facing triangle
+    RayCast,    // cast ray per screen cell through object hierarchy, falls back to raster for compact vertices
+    Auto        // ray casting when faces per covered cell exceed limit
+};
+
 class Renderer {
 public:
-    // renders object into buffer with given view parameters
-    static void render(Buffer &buf, const Object &obj, const Camera &cam, const Light  &light, bool static_light, bool color_support) ;
+    // renders object into buffer with given view parameters, object normals must be computed
+    static void render(RenderContext &ctx, Buffer &buf, const Object &obj, const Camera &cam, const Light  &light, bool static_light, bool color_support, Backend backend) ;
 
 private:
-    // returns luminance character based on angle between normal and light
-    static char luminance_char(const Vec3 &normal, const Vec3 &light, const std::string &scale = CHARS_LUM);
+    // screen cells covered by projected bounding circle of object
+    static float covered_cells(const Object &obj, const Buffer &buf, const Camera &cam);
+
+    // rotation rows of camera, dot products with rows give view space coordinates
+    static std::array<Vec3, 3> view_rows(const Camera &cam);
+
+    // returns coarsest level of detail that keeps enough faces per covered screen cell
+    static const Object &select_lod(const Object &obj, const Buffer &buf, const Camera &cam);
+
+    // frame pipeline specialized on light mode and color support
+    template <bool StaticLight, bool Color>
+    static void draw(RenderContext &ctx, Buffer &buf, const Object &lod, const Camera &cam, const Light &light);
+
+    // ray casting pipeline over object hierarchy, one ray per cell center, rows in parallel
+    template <bool StaticLight, bool Color>
+    static void cast(RenderContext &ctx, Buffer &buf, const Object &obj, const Camera &cam, const Light &light);
+
+    // point cloud pipeline, nearest point per cell shaded by number of points in cell
+    static void splat(RenderContext &ctx, Buffer &buf, const Object &obj, const Camera &cam);
+
+    // returns cached face luminance for static light, recomputed only when light or geometry changes
+    static const std::vector<char> &static_luminance(RenderContext &ctx, const Object &lod, const Light &light);
+
+    // returns luminance character based on cosine of angle between normal and light
+    static char luminance_char(float cosine);
 };
@@ -0,0 +1,44 @@
+/*
+ * turntable.cpp
+ */
+
+#include "turntable.h"
+
+#include "utils/parallel.h"
+
+Turntable::Turntable(const Object &obj, const Camera &cam, const Buffer &buf, const Light &light, const bool static_light, const bool color_support, const Backend backend, const float step_deg) :
+    step(step_deg), altitude(cam.altitude), zoom(cam.zoom), x(buf.x), y(buf.y)
+{
+    const auto count = static_cast<size_t>(std::max(1.0f, std::round(360.0f / step)));
+    step = 360.0f / static_cast<float>(count);
+    frames.resize(count);
+
+    parallel_for(count, [&](const size_t begin, const size_t end) {
+        RenderContext ctx;
+        ctx.threads = 1; // frames already rendered in parallel
+        ctx.reserve(obj);
+        Buffer frame(buf.x, buf.y, buf.logical_x, buf.logical_y);
+
+        for (size_t i = begin; i < end; i++)
+        {
+            const Camera view(deg2rad(static_cast<float>(i) * step), altitude, zoom);
+
+            frame.clear();
+            Renderer::render(ctx, frame, obj, view, light, static_light, color_support, backend);
+            frames[i] = CompressedFrame::compress(frame);
+        }
+    });
+}
+
+bool Turntable::restore(const Camera &cam, Buffer &buf) const
+{
+    if (buf.x != x || buf.y != y || cam.altitude != altitude || cam.zoom != zoom)
+    {
+        return false;
+    }
+
+    const auto index = static_cast<size_t>(std::lround(deg_norm(rad2deg(cam.azimuth)) / step)) % frames.size();
+    frames[index].restore(buf);
+
+    return true;
+}
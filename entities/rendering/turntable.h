@@ -0,0 +1,26 @@
+/*
+ * turntable.h
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "frame_cache.h"
+#include "renderer.h"
+
+// one revolution of pre-rendered frames played back instead of live animation
+class Turntable {
+public:
+    // renders frames around vertical axis at given angular step in parallel
+    Turntable(const Object &obj, const Camera &cam, const Buffer &buf, const Light &light, bool static_light, bool color_support, Backend backend, float step_deg);
+
+    bool restore(const Camera &cam, Buffer &buf) const;    // copies nearest frame, fails when view no longer matches
+
+private:
+    float step;                 // deg
+    float altitude;             // rad
+    float zoom;
+    unsigned int x, y;          // buffer size
+    std::vector<CompressedFrame> frames;
+};
@@ -12,11 +12,17 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <iomanip>
 #include <thread>
 
 #include "entities/geometry/object.h"
 #include "entities/rendering/buffer.h"
+#include "entities/rendering/frame_cache.h"
+#include "entities/rendering/prefetcher.h"
+#include "entities/rendering/turntable.h"
 #include "entities/rendering/renderer.h"
+#include "utils/latency.h"
+#include "utils/memory.h"
 #include "utils/tools.h"
 #include "config.h"
 #include "version.h"
@@ -46,7 +52,7 @@ void init_ncurses()
     noecho();               // disable echoing of typed characters
     curs_set(0);            // hide the cursor
     keypad(stdscr, true);   // enable special keys (arrows, etc.)
-    timeout(1);             // make getch() non-blocking
+    timeout(0);             // make getch() non-blocking
 }
 
 void init_colors(const std::vector<Material> &materials, Theme theme)
@@ -109,17 +115,27 @@ void init_colors(const std::vector<Material> &materials, Theme theme)
 static void print_help()
 {
     std::cout <<
-        "Usage: " << APP_NAME << " [OPTIONS] <file.obj>\n"
+        "Usage: " << APP_NAME << " [OPTIONS] <file.obj|file.stl|file.ply>\n"
         "\n"
         "Options:\n"
         "  -c, --color <theme>  Enable colors support, optional theme {dark|light|transparent}\n"
         "  -l, --light          Disable light rotation\n"
         "  -a, --animate <deg>  Start with animated object, optional speed [default: " << std::fixed << std::setprecision(1) << ANIMATION_STEP << std::defaultfloat << " deg/s]\n"
+        "  -t, --turntable <d>  Pre-render animation with angular step [default: " << std::fixed << std::setprecision(1) << TURNTABLE_STEP << std::defaultfloat << " deg]\n"
         "  -z, --zoom <x>       Provide initial zoom [default: " << std::fixed << std::setprecision(1) << ZOOM_START << std::defaultfloat << " x]\n"
         "      --flip           Flip faces winding order\n"
+        "      --compact        Store vertices as 16-bit fixed point\n"
+        "      --occlusion      Skip geometry hidden behind previous frame visible geometry\n"
+        "      --backend <name> Render backend {raster|raycast|auto} [default: auto]\n"
+        "      --cache <mb>     Limit memory of cached frames, 0 disables cache [default: " << FRAME_CACHE_MB << " MB]\n"
+        "      --weld <eps>     Weld vertices closer than eps of model size [default: " << WELD_EPSILON << "]\n"
         "      --invert-x       Flip geometry along X axis\n"
         "      --invert-y       Flip geometry along Y axis\n"
         "      --invert-z       Flip geometry along Z axis\n"
+        "      --latency        Print input to display latency statistics on exit\n"
+        "      --strict         Stop loading at first malformed line\n"
+        "      --silent         Skip malformed lines without warnings\n"
+        "  -b, --bench <n>      Render n frames off-screen and print statistics\n"
         "  -h, --help           Print help\n"
         "  -v, --version        Print version\n"
         "\n"
@@ -151,10 +167,29 @@ struct Args {
     bool invert_y = false;              // -y / --invert-y
     bool invert_z = false;              // -z / --invert-z
 
+    bool weld = false;                  // --weld
+    float weld_epsilon = WELD_EPSILON;
+
     bool animate = false;               // -a / --animate
     float speed = ANIMATION_STEP;   // deg/s
 
+    bool turntable = false;             // -t / --turntable
+    float turntable_step = TURNTABLE_STEP;  // deg
+
     float zoom = ZOOM_START;            // -z / --zoom
+
+    int bench_frames = 0;               // -b / --bench
+
+    int cache_mb = FRAME_CACHE_MB;      // --cache
+
+    bool occlusion = false;             // --occlusion
+    bool compact = false;               // --compact
+
+    Backend backend = Backend::Auto;    // --backend
+
+    bool latency = false;               // --latency
+
+    DiagnosticMode diagnostics = DiagnosticMode::Normal;    // --strict / --silent
 };
 
 static Args parse_args(int argc, char **argv)
@@ -214,7 +249,7 @@ static Args parse_args(int argc, char **argv)
 
             if (i + 1 < argc && argv[i + 1][0] != '-')
             {
-                if (auto val = safe_stof(argv[i + 1]); val)
+                if (auto val = parse_float(argv[i + 1]); val)
                 {
                     a.speed = val.value();
                     ++i;
@@ -222,6 +257,21 @@ static Args parse_args(int argc, char **argv)
                 // else - file name
             }
         }
+        else if (arg == "-t" || arg == "--turntable")
+        {
+            a.animate = true;
+            a.turntable = true;
+
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                if (auto val = parse_float(argv[i + 1]); val && val.value() > 0.0f)
+                {
+                    a.turntable_step = val.value();
+                    ++i;
+                }
+                // else - file name
+            }
+        }
         else if (arg == "-z" || arg == "--zoom")
         {
             if (++i == argc)
@@ -230,7 +280,7 @@ static Args parse_args(int argc, char **argv)
                 std::exit(1);
             }
 
-            auto val = safe_stof(argv[i]);
+            auto val = parse_float(argv[i]);
 
             if (!val)
             {
@@ -240,10 +290,107 @@ static Args parse_args(int argc, char **argv)
 
             a.zoom = val.value();
         }
+        else if (arg == "-b" || arg == "--bench")
+        {
+            if (++i == argc)
+            {
+                std::cerr << "error: bench needs value\n";
+                std::exit(1);
+            }
+
+            auto val = parse_int(argv[i]);
+
+            if (!val || val.value() <= 0)
+            {
+                std::cerr << "error: invalid bench value\n";
+                std::exit(1);
+            }
+
+            a.bench_frames = val.value();
+        }
         else if (arg == "--flip")
         {
             a.flip_faces = true;
         }
+        else if (arg == "--backend")
+        {
+            if (++i == argc)
+            {
+                std::cerr << "error: backend needs value\n";
+                std::exit(1);
+            }
+
+            std::string_view name{argv[i]};
+            if (name == "raster")
+            {
+                a.backend = Backend::Raster;
+            }
+            else if (name == "raycast")
+            {
+                a.backend = Backend::RayCast;
+            }
+            else if (name == "auto")
+            {
+                a.backend = Backend::Auto;
+            }
+            else
+            {
+                std::cerr << "error: invalid backend value\n";
+                std::exit(1);
+            }
+        }
+        else if (arg == "--compact")
+        {
+            a.compact = true;
+        }
+        else if (arg == "--occlusion")
+        {
+            a.occlusion = true;
+        }
+        else if (arg == "--latency")
+        {
+            a.latency = true;
+        }
+        else if (arg == "--strict")
+        {
+            a.diagnostics = DiagnosticMode::Strict;
+        }
+        else if (arg == "--silent")
+        {
+            a.diagnostics = DiagnosticMode::Silent;
+        }
+        else if (arg == "--cache")
+        {
+            if (++i == argc)
+            {
+                std::cerr << "error: cache needs value\n";
+                std::exit(1);
+            }
+
+            auto val = parse_int(argv[i]);
+
+            if (!val || val.value() < 0)
+            {
+                std::cerr << "error: invalid cache value\n";
+                std::exit(1);
+            }
+
+            a.cache_mb = val.value();
+        }
+        else if (arg == "--weld")
+        {
+            a.weld = true;
+
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                if (auto val = parse_float(argv[i + 1]); val)
+                {
+                    a.weld_epsilon = val.value();
+                    ++i;
+                }
+                // else - file name
+            }
+        }
         else if (arg == "--invert-x")
         {
             a.invert_x = true;
@@ -287,7 +434,7 @@ static Args parse_args(int argc, char **argv)
 
 // helpers
 
-void render_hud(const Camera &cam, const float fps)
+void render_hud(const Camera &cam, const float fps, const float latency_ms, const LatencyHistogram &latencies, const FrameCache &cache)
 {
     if (g_hud_pair)
         attron(COLOR_PAIR(g_hud_pair));
@@ -296,11 +443,76 @@ void render_hud(const Camera &cam, const float fps)
     mvprintw(1, 0, "zoom      %6.1f x", cam.zoom);
     mvprintw(2, 0, "azimuth   %6.1f deg", clamp0(rad2deg(cam.azimuth)));
     mvprintw(3, 0, "altitude  %6.1f deg", clamp0(rad2deg(cam.altitude)));
+    mvprintw(4, 0, "latency   %6.1f ms p50 %.1f p95 %.1f p99 %.1f max %.1f", latency_ms,
+             latencies.percentile(0.50f), latencies.percentile(0.95f), latencies.percentile(0.99f), latencies.max());
+    mvprintw(5, 0, "cache     %6.1f %% hit %zu kb", cache.hit_rate() * 100.0f, cache.memory() / 1024);
 
     if (g_hud_pair)
         attroff(COLOR_PAIR(g_hud_pair));
 }
 
+// load-time statistics reported by benchmark
+struct LoadStats {
+    float load_ms = 0.0f;
+    size_t rss_before_kb = 0;   // peak resident memory before and after loading
+    size_t rss_after_kb = 0;
+    float acmr_before = 0.0f;
+    float acmr_after = 0.0f;
+};
+
+// render frames into off-screen buffer, rotating by one step per frame
+void run_bench(const Object &obj, const Args &args, const LoadStats &stats)
+{
+    const float logical_y = 2.0f;
+    const float logical_x = logical_y * static_cast<float>(BENCH_COLS) / (static_cast<float>(BENCH_ROWS) * CHAR_ASPECT_RATIO);
+
+    Buffer buf(BENCH_COLS, BENCH_ROWS, logical_x, logical_y);
+
+    // levels interactive run builds in background, waited for so every frame sees them
+    const auto lods_start = SteadyClock::now();
+    if (!obj.point_cloud() && obj.faces.size() / 2 >= LOD_MIN_FACES)
+    {
+        obj.request_lods(static_cast<size_t>(static_cast<float>(buf.x * buf.y) * LOD_FACES_PER_PIXEL));
+        obj.wait_lods();
+    }
+    const float lods_ms = std::chrono::duration<float, std::milli>(SteadyClock::now() - lods_start).count();
+
+    RenderContext ctx(obj);
+    ctx.occlusion = args.occlusion;
+    Camera cam(args.zoom);
+    Light light;
+
+    const auto allocations = allocation_count();
+    const auto start = SteadyClock::now();
+
+    for (int i = 0; i < args.bench_frames; i++)
+    {
+        buf.clear();
+        Renderer::render(ctx, buf, obj, cam, light, args.static_light, args.color_support, args.backend);
+        cam.rotate_left();
+    }
+
+    const float total_ms = std::chrono::duration<float, std::milli>(SteadyClock::now() - start).count();
+    const auto allocations_after = allocation_count();
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "vertices   " << obj.vertex_count() << '\n'
+              << "faces      " << obj.faces.size() << '\n'
+              << "meshlets   " << obj.meshlets.size() << '\n'
+              << "lods       " << obj.levels().size() << " in " << lods_ms << " ms\n"
+              << "acmr       " << stats.acmr_before << " -> " << stats.acmr_after << '\n'
+              << "load       " << stats.load_ms << " ms\n"
+              << "peak rss   " << stats.rss_before_kb / 1024 << " mb -> " << stats.rss_after_kb / 1024 << " mb\n"
+              << "frames     " << args.bench_frames << '\n'
+              << "frame time " << total_ms / static_cast<float>(args.bench_frames) << " ms\n"
+              << "allocs     ";
+
+    if (allocations && allocations_after)
+        std::cout << *allocations_after - *allocations << '\n';
+    else
+        std::cout << "not counted, configure with -DCOUNT_ALLOCATIONS=ON\n";
+}
+
 void handle_control(const int ch, Camera &cam)
 {
     switch (ch)
@@ -337,31 +549,68 @@ int main(int argc, char **argv)
     const Args args = parse_args(argc, argv);
 
     // load object
+    const auto load_start = SteadyClock::now();
+    LoadStats stats;
+    stats.rss_before_kb = peak_rss_kb();
+
     Object obj;
-    if (!obj.load(args.input_file.string(), args.color_support))
+    if (!obj.load(args.input_file.string(), args.color_support, args.diagnostics))
     {
         return 1;
     }
 
-    // normalize to unit cube
-    obj.normalize();
+    // memory of parsing alone, before derived data is built
+    stats.rss_after_kb = peak_rss_kb();
+
+    // center, resize to make model >= 0.5 screen size, flip winding and invert along axes in one pass
+    obj.place(OBJECT_SIZE, args.flip_faces, args.invert_x, args.invert_y, args.invert_z);
+
+    // merge duplicated vertices, epsilon is relative to model size
+    if (args.weld)
+    {
+        const size_t removed = obj.weld(args.weld_epsilon * OBJECT_SIZE);
+        std::cerr << "info: welded " << removed << " vertices" << std::endl;
+    }
+
+    if (args.bench_frames)
+        stats.acmr_before = obj.acmr();
+
+    // per-face normals and clusters for culling
+    obj.compute_normals();
+    obj.build_meshlets();
 
-    // resize to make model >= 0.5 screen size
-    obj.scale(3.0f);
+    // vertex cache friendly order, skipped for large models where it would dominate startup
+    if (obj.faces.size() <= CACHE_OPTIMIZE_MAX_FACES)
+        obj.optimize_cache();
 
-    // flip faces winding order
-    if (args.flip_faces)
-        obj.flip_faces();
+    // ray casting hierarchy up front when forced, auto mode builds it on first frame choosing rays
+    if (args.backend == Backend::RayCast)
+    {
+        obj.build_bvh();
+    }
 
-    // invert along axes
-    if (args.invert_x)
-        obj.invert_x();
+    // fixed point vertices, only forced ray casting needs float positions, auto mode keeps rasterizing compact models
+    if (args.compact && args.backend == Backend::RayCast)
+    {
+        std::cerr << "warning: compact vertices not supported with ray casting" << std::endl;
+    }
+    else if (args.compact)
+    {
+        const size_t before = obj.vertex_count() * sizeof(Vec3);
+        const float error = obj.compact();
+        std::cerr << "info: compact vertices " << before / 1024 << " kb -> " << obj.vertex_count() * sizeof(QVertex) / 1024
+                  << " kb, max error " << error << " (" << error / (2.0f * obj.qscale * INT16_MAX) * 100.0f << " % of size)" << std::endl;
+    }
 
-    if (args.invert_y)
-        obj.invert_y();
+    // benchmark without terminal
+    if (args.bench_frames)
+    {
+        stats.acmr_after = obj.acmr();
+        stats.load_ms = std::chrono::duration<float, std::milli>(SteadyClock::now() - load_start).count();
 
-    if (args.invert_z)
-        obj.invert_z();
+        run_bench(obj, args, stats);
+        return 0;
+    }
 
     // init curses
     init_ncurses();
@@ -381,17 +630,38 @@ int main(int argc, char **argv)
 
     Buffer buf(static_cast<unsigned int>(cols), static_cast<unsigned int>(rows), logical_x, logical_y);
 
+    // scratch storage reused by every frame
+    RenderContext ctx(obj);
+    ctx.occlusion = args.occlusion;
+
+    // previously seen views
+    FrameCache cache(static_cast<size_t>(args.cache_mb) * 1024 * 1024);
+    const uint32_t frame_flags = (args.static_light ? 1u : 0u) | (args.color_support ? 2u : 0u);
+
     // view
     Camera cam(args.zoom);  // constructor with zoom
     Light light;            // default
     bool hud = false;
 
+    // neighbouring views rendered ahead while idle
+    std::optional<Prefetcher> prefetcher;
+    if (cache.enabled())
+        prefetcher.emplace(obj, cache, light, args.static_light, args.color_support, args.backend);
+
     // animation
     bool rotate = args.animate;
     auto last = SteadyClock::now();
 
+    // pre-rendered revolution for animation
+    std::optional<Turntable> turntable;
+    if (args.turntable)
+        turntable.emplace(obj, cam, buf, light, args.static_light, args.color_support, args.backend, args.turntable_step);
+
     // optimizing drawing
     bool needs_redraw = true;
+    float latency_ms = 0.0f;    // input to display of first input of last displayed frame
+    LatencyHistogram latencies;
+    std::vector<SteadyClock::time_point> inputs;    // read times of inputs not yet displayed
 
     // main render loop
     while (true)
@@ -406,40 +676,69 @@ int main(int argc, char **argv)
             needs_redraw = true;
         }
 
-        // handle key
-        int ch = getch();
+        // handle all pending keys, render once for combined result
+        bool quit = false;
 
-        if (ch == KEY_RESIZE)
+        for (int ch = getch(); ch != ERR; ch = getch())
         {
-            getmaxyx(stdscr, rows, cols);
-            const float lx = logical_y * static_cast<float>(cols) / (static_cast<float>(rows) * CHAR_ASPECT_RATIO);
-            buf = Buffer(static_cast<unsigned int>(cols), static_cast<unsigned int>(rows), lx, logical_y);
-            needs_redraw = true;
+            inputs.push_back(SteadyClock::now());
+
+            // input makes speculative work stale
+            if (prefetcher)
+                prefetcher->cancel();
+
+            if (ch == KEY_RESIZE)
+            {
+                getmaxyx(stdscr, rows, cols);
+                const float lx = logical_y * static_cast<float>(cols) / (static_cast<float>(rows) * CHAR_ASPECT_RATIO);
+                buf = Buffer(static_cast<unsigned int>(cols), static_cast<unsigned int>(rows), lx, logical_y);
+                turntable.reset();  // frames no longer match buffer
+                needs_redraw = true;
+            }
+            else if (ch == 'q' || ch == 'Q')     // exit
+            {
+                quit = true;
+                break;
+            }
+            else if (ch == '\t')                 // toggle hud
+            {
+                hud = !hud;
+                needs_redraw = true;
+            }
+            else
+            {
+                rotate = false;                // stop animation on first movement
+                turntable.reset();
+                handle_control(ch, cam);    // handle camera control
+                needs_redraw = true;
+            }
         }
-        else if (ch == 'q' || ch == 'Q')     // exit
+
+        if (quit)
         {
             break;
         }
-        else if (ch == '\t')                 // toggle hud
-        {
-            hud = !hud;
-            needs_redraw = true;
-        }
-        else if (ch != ERR)
-        {
-            rotate = false;                // stop animation on first movement
-            handle_control(ch, cam);    // handle camera control
-            needs_redraw = true;
-        }
 
         // redrawing
         if (needs_redraw)
         {
-            // clear buffer
-            buf.clear();
+            // animated views are never revisited, skip cache
+            const FrameKey key(cam, buf, frame_flags);
+
+            // animation plays back pre-rendered revolution when available
+            const bool played = rotate && turntable && turntable->restore(cam, buf);
+
+            if (!played && (rotate || !cache.restore(key, buf)))
+            {
+                // clear buffer
+                buf.clear();
 
-            // render model
-            Renderer::render(buf, obj, cam, light, args.static_light, args.color_support);
+                // render model
+                Renderer::render(ctx, buf, obj, cam, light, args.static_light, args.color_support, args.backend);
+
+                if (!rotate)
+                    cache.store(key, buf);
+            }
 
             move(0, 0);
             buf.printw();
@@ -447,17 +746,34 @@ int main(int argc, char **argv)
             // render hud
             if (hud)
             {
-                render_hud(cam, fps);
+                render_hud(cam, fps, latency_ms, latencies, cache);
             }
 
             // draw buffer
             refresh();
 
+            // time from key press to visible frame, every input recorded, headline from first one
+            const auto shown = SteadyClock::now();
+            for (const auto &input : inputs)
+            {
+                latencies.record(std::chrono::duration<float, std::milli>(shown - input).count());
+            }
+
+            if (!inputs.empty())
+            {
+                latency_ms = std::chrono::duration<float, std::milli>(shown - inputs.front()).count();
+            }
+            inputs.clear();
+
             needs_redraw = false;
+
+            // speculate around still camera
+            if (!rotate && prefetcher)
+                prefetcher->schedule(cam, buf);
         }
         else if (hud) // update only hud
         {
-            render_hud(cam, fps);
+            render_hud(cam, fps, latency_ms, latencies, cache);
             refresh();
         }
 
@@ -467,5 +783,11 @@ int main(int argc, char **argv)
     }
 
     endwin();
+
+    if (args.latency)
+    {
+        latencies.print(std::cout);
+    }
+
     return 0;
 }
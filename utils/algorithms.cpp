@@ -4,6 +4,11 @@
 
 #include "algorithms.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
 // helper functions
 
 static bool is_in_triangle(const Vec3 &pt, const Vec3 &v1, const Vec3 &v2, const Vec3 &v3, const Vec3 &normal)
@@ -53,6 +58,43 @@ static bool is_ear(const size_t i, const std::vector<Vec3> &points, const std::v
     return true; // ear found
 }
 
+// packed grid cell coordinates, wrapping only merges hash chains
+static uint64_t cell_key(const int64_t x, const int64_t y, const int64_t z)
+{
+    constexpr uint64_t mask = (1u << 21) - 1;
+    return (static_cast<uint64_t>(x) & mask) | ((static_cast<uint64_t>(y) & mask) << 21) | ((static_cast<uint64_t>(z) & mask) << 42);
+}
+
+// forsyth vertex score from position in lru cache and number of remaining triangles
+static float vertex_score(const int cache_position, const unsigned int remaining)
+{
+    constexpr int cache_size = 32;
+
+    if (remaining == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+        {
+            score = 0.75f; // triangle just added
+        }
+        else
+        {
+            const float scaler = 1.0f / (cache_size - 3);
+            score = std::pow(1.0f - static_cast<float>(cache_position - 3) * scaler, 1.5f);
+        }
+    }
+
+    // bonus for vertices with few remaining triangles
+    score += 2.0f / std::sqrt(static_cast<float>(remaining));
+
+    return score;
+}
+
 // main functions
 
 float lerp(const float a, const float b, const float t)
@@ -120,6 +162,223 @@ std::optional<std::vector<size_t>> triangularize(const std::vector<Vec3> &points
     return result;
 }
 
+std::vector<unsigned int> weld_points(const std::vector<Vec3> &points, const float epsilon, std::vector<Vec3> &unique)
+{
+    const float cell = std::max(epsilon, 1e-6f);
+    const float inv_cell = 1.0f / cell;
+
+    std::vector<unsigned int> remap(points.size());
+    unique.clear();
+
+    // chains of unique points per grid cell
+    std::unordered_map<uint64_t, unsigned int> heads;
+    std::vector<unsigned int> next;
+    constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const Vec3 &p = points[i];
+        const auto cx = static_cast<int64_t>(std::floor(p.x * inv_cell));
+        const auto cy = static_cast<int64_t>(std::floor(p.y * inv_cell));
+        const auto cz = static_cast<int64_t>(std::floor(p.z * inv_cell));
+
+        unsigned int found = none;
+        for (int64_t dx = -1; dx <= 1 && found == none; dx++)
+        for (int64_t dy = -1; dy <= 1 && found == none; dy++)
+        for (int64_t dz = -1; dz <= 1 && found == none; dz++)
+        {
+            const auto it = heads.find(cell_key(cx + dx, cy + dy, cz + dz));
+            for (unsigned int u = (it != heads.end()) ? it->second : none; u != none; u = next[u])
+            {
+                if ((unique[u] - p).magnitude() <= epsilon)
+                {
+                    found = u;
+                    break;
+                }
+            }
+        }
+
+        if (found == none)
+        {
+            found = static_cast<unsigned int>(unique.size());
+            unique.push_back(p);
+
+            auto [it, inserted] = heads.try_emplace(cell_key(cx, cy, cz), found);
+            next.push_back(inserted ? none : it->second);
+            it->second = found;
+        }
+
+        remap[i] = found;
+    }
+
+    return remap;
+}
+
+std::vector<unsigned int> optimize_vertex_cache(const std::vector<unsigned int> &indices)
+{
+    constexpr int cache_size = 32;
+    const size_t tcount = indices.size() / 3;
+
+    // local vertex numbering
+    std::vector<unsigned int> ids(indices);
+    std::ranges::sort(ids);
+    ids.erase(std::ranges::unique(ids).begin(), ids.end());
+
+    std::vector<unsigned int> local(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        local[i] = static_cast<unsigned int>(std::ranges::lower_bound(ids, indices[i]) - ids.begin());
+    }
+
+    const size_t vcount = ids.size();
+
+    // vertex to triangles adjacency
+    std::vector<unsigned int> offsets(vcount + 1, 0);
+    for (const auto v : local)
+    {
+        offsets[v + 1]++;
+    }
+
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<unsigned int> adjacency(local.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < local.size(); i++)
+    {
+        adjacency[fill[local[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<unsigned int> remaining(vcount);
+    std::vector<int> position(vcount, -1);
+    std::vector<float> vscore(vcount);
+    for (size_t v = 0; v < vcount; v++)
+    {
+        remaining[v] = offsets[v + 1] - offsets[v];
+        vscore[v] = vertex_score(-1, remaining[v]);
+    }
+
+    std::vector<float> tscore(tcount);
+    std::vector<bool> added(tcount, false);
+    for (size_t t = 0; t < tcount; t++)
+    {
+        tscore[t] = vscore[local[t * 3]] + vscore[local[t * 3 + 1]] + vscore[local[t * 3 + 2]];
+    }
+
+    std::vector<unsigned int> order;
+    order.reserve(tcount);
+
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> next_cache;
+    size_t scan = 0;
+    size_t best = tcount;
+
+    while (order.size() < tcount)
+    {
+        // no candidate around cache, take best of remaining triangles
+        if (best == tcount)
+        {
+            float best_score = -1.0f;
+            while (scan < tcount && added[scan])
+            {
+                scan++;
+            }
+
+            for (size_t t = scan; t < tcount; t++)
+            {
+                if (!added[t] && tscore[t] > best_score)
+                {
+                    best_score = tscore[t];
+                    best = t;
+                }
+            }
+        }
+
+        added[best] = true;
+        order.push_back(static_cast<unsigned int>(best));
+
+        // new cache with added triangle in front
+        next_cache.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            const unsigned int v = local[best * 3 + k];
+            next_cache.push_back(v);
+            remaining[v]--;
+        }
+
+        for (const auto v : cache)
+        {
+            if (std::ranges::find(next_cache, v) == next_cache.end())
+            {
+                next_cache.push_back(v);
+            }
+        }
+
+        // update scores of cached vertices and their triangles
+        for (size_t i = 0; i < next_cache.size(); i++)
+        {
+            const unsigned int v = next_cache[i];
+            position[v] = (i < static_cast<size_t>(cache_size)) ? static_cast<int>(i) : -1;
+            vscore[v] = vertex_score(position[v], remaining[v]);
+        }
+
+        best = tcount;
+        float best_score = -1.0f;
+
+        for (const auto v : next_cache)
+        {
+            for (unsigned int k = offsets[v]; k < offsets[v + 1]; k++)
+            {
+                const unsigned int t = adjacency[k];
+                if (added[t])
+                {
+                    continue;
+                }
+
+                tscore[t] = vscore[local[t * 3]] + vscore[local[t * 3 + 1]] + vscore[local[t * 3 + 2]];
+                if (tscore[t] > best_score)
+                {
+                    best_score = tscore[t];
+                    best = t;
+                }
+            }
+        }
+
+        if (next_cache.size() > static_cast<size_t>(cache_size))
+        {
+            next_cache.resize(cache_size);
+        }
+
+        std::swap(cache, next_cache);
+    }
+
+    return order;
+}
+
+float acmr(const std::vector<unsigned int> &indices, const size_t cache_size)
+{
+    if (indices.size() < 3)
+    {
+        return 0.0f;
+    }
+
+    // fifo cache as ring of timestamps
+    std::unordered_map<unsigned int, size_t> inserted;
+    size_t misses = 0;
+
+    for (const auto v : indices)
+    {
+        if (const auto it = inserted.find(v); it != inserted.end() && misses - it->second < cache_size)
+        {
+            continue;
+        }
+
+        inserted[v] = misses;
+        misses++;
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
 float deg2rad(float degree)
 {
     return degree * PI / 180.f;
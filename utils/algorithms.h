@@ -23,6 +23,15 @@ T clamp(const T &value, const T &low, const T &high)
 // polygon triangulation
 std::optional<std::vector<size_t>> triangularize(const std::vector<Vec3> &points);
 
+// spatial hash welding, maps every point to its representative in list of unique points
+std::vector<unsigned int> weld_points(const std::vector<Vec3> &points, float epsilon, std::vector<Vec3> &unique);
+
+// post-transform vertex cache optimization (forsyth), returns new order of triangles of index list
+std::vector<unsigned int> optimize_vertex_cache(const std::vector<unsigned int> &indices);
+
+// average cache miss ratio - transformed vertices per triangle with fifo cache of given size
+float acmr(const std::vector<unsigned int> &indices, size_t cache_size);
+
 // transformations
 float deg2rad(float degree);
 float rad2deg(float radian);
@@ -0,0 +1,51 @@
+/*
+ * latency.cpp
+ */
+
+#include "latency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+void LatencyHistogram::record(const float ms)
+{
+    const auto bucket = static_cast<size_t>(std::max(ms, 0.0f) / LATENCY_RESOLUTION);
+    buckets[std::min(bucket, buckets.size() - 1)]++;
+
+    total++;
+    longest = std::max(longest, ms);
+}
+
+float LatencyHistogram::percentile(const float p) const
+{
+    if (total == 0)
+    {
+        return 0.0f;
+    }
+
+    // smallest bucket with at least p of samples at or below it
+    const auto rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(p * static_cast<float>(total))));
+    size_t seen = 0;
+
+    for (size_t i = 0; i < buckets.size(); i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            return std::min(static_cast<float>(i + 1) * LATENCY_RESOLUTION, longest);
+        }
+    }
+
+    return longest;
+}
+
+void LatencyHistogram::print(std::ostream &os) const
+{
+    os << std::fixed << std::setprecision(1)
+       << "inputs     " << total << '\n'
+       << "p50        " << percentile(0.50f) << " ms\n"
+       << "p95        " << percentile(0.95f) << " ms\n"
+       << "p99        " << percentile(0.99f) << " ms\n"
+       << "max        " << longest << " ms\n";
+}
@@ -0,0 +1,28 @@
+/*
+ * latency.h
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "config.h"
+
+// histogram of input to display latencies with fixed resolution buckets
+class LatencyHistogram {
+public:
+    void record(float ms);
+
+    [[nodiscard]] size_t count() const { return total; }
+    [[nodiscard]] float max() const { return longest; }
+    [[nodiscard]] float percentile(float p) const;     // upper bound of bucket holding p-th percentile, p in [0, 1]
+
+    void print(std::ostream &os) const;
+
+private:
+    std::array<uint32_t, LATENCY_BUCKETS> buckets{};   // last bucket collects all longer latencies
+    size_t total = 0;
+    float longest = 0.0f;
+};
@@ -0,0 +1,62 @@
+/*
+ * mapped_file.cpp
+ */
+
+#include "mapped_file.h"
+
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+    if (data)
+    {
+        munmap(const_cast<char *>(data), size);
+    }
+}
+
+bool MappedFile::open(const std::string &filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "error: can't open file " << filename << std::endl;
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0)
+    {
+        std::cerr << "error: can't open file " << filename << std::endl;
+        close(fd);
+        return false;
+    }
+
+    // empty file maps to empty view
+    size = static_cast<size_t>(st.st_size);
+    if (size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // mapping stays valid
+
+    if (p == MAP_FAILED)
+    {
+        std::cerr << "error: can't map file " << filename << std::endl;
+        size = 0;
+        return false;
+    }
+
+    // file is read front to back once
+    madvise(p, size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char *>(p);
+    return true;
+}
@@ -0,0 +1,27 @@
+/*
+ * mapped_file.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// read-only memory mapping of whole file, unmapped on destruction
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &filename);     // prints error on failure
+
+    [[nodiscard]] std::string_view view() const { return {data, size}; }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+};
@@ -0,0 +1,59 @@
+/*
+ * memory.cpp
+ */
+
+#include "memory.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <sys/resource.h>
+
+#ifdef COUNT_ALLOCATIONS
+static std::atomic<size_t> g_allocations{0};
+#endif
+
+std::optional<size_t> allocation_count()
+{
+#ifdef COUNT_ALLOCATIONS
+    return g_allocations.load(std::memory_order_relaxed);
+#else
+    return std::nullopt;
+#endif
+}
+
+size_t peak_rss_kb()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss); // kb on linux
+}
+
+#ifdef COUNT_ALLOCATIONS
+
+// replaced global allocation functions, array and nothrow forms forward to these
+
+void *operator new(const size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * memory.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+// number of heap allocations made through operator new since program start, empty unless built with COUNT_ALLOCATIONS
+std::optional<size_t> allocation_count();
+
+// peak resident set size of process in kb
+size_t peak_rss_kb();
@@ -0,0 +1,91 @@
+/*
+ * parallel.cpp
+ */
+
+#include "parallel.h"
+
+WorkerPool::WorkerPool(const unsigned int workers)
+{
+    threads.reserve(std::max(1u, workers) - 1);
+    for (size_t w = 1; w < std::max(1u, workers); w++)
+    {
+        threads.emplace_back([this, w] { work(w); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        quit = true;
+    }
+    start.notify_all();
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+}
+
+void WorkerPool::dispatch(const size_t count, const Job fn, void *data)
+{
+    const size_t workers = std::min<size_t>(size(), count);
+    if (workers <= 1)
+    {
+        if (count > 0)
+        {
+            fn(data, 0, count);
+        }
+        return;
+    }
+
+    const size_t chunk = (count + workers - 1) / workers;
+    {
+        std::lock_guard lock(mutex);
+        job = fn;
+        job_fn = data;
+        job_count = count;
+        job_chunk = chunk;
+        pending = threads.size();
+        generation++;
+    }
+    start.notify_all();
+
+    fn(data, 0, std::min(count, chunk)); // first chunk on calling thread
+
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+}
+
+void WorkerPool::work(const size_t index)
+{
+    uint64_t seen = 0;
+
+    while (true)
+    {
+        std::unique_lock lock(mutex);
+        start.wait(lock, [this, seen] { return quit || generation != seen; });
+        if (quit)
+        {
+            return;
+        }
+
+        seen = generation;
+        const Job fn = job;
+        void *data = job_fn;
+        const size_t begin = std::min(job_count, index * job_chunk);
+        const size_t end = std::min(job_count, begin + job_chunk);
+        lock.unlock();
+
+        if (begin < end)
+        {
+            fn(data, begin, end);
+        }
+
+        lock.lock();
+        if (--pending == 0)
+        {
+            done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * parallel.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// number of worker threads for parallel loops
+inline unsigned int worker_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// runs fn(begin, end) over contiguous chunks of [0, count) on all hardware threads
+template <typename Fn>
+void parallel_for(const size_t count, Fn &&fn)
+{
+    const size_t workers = std::min<size_t>(worker_count(), count);
+    if (workers <= 1)
+    {
+        if (count > 0)
+        {
+            fn(size_t{0}, count);
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+
+    const size_t chunk = (count + workers - 1) / workers;
+    for (size_t w = 1; w < workers; w++)
+    {
+        const size_t begin = std::min(count, w * chunk);
+        const size_t end = std::min(count, begin + chunk);
+        threads.emplace_back([&fn, begin, end] { fn(begin, end); });
+    }
+
+    fn(size_t{0}, std::min(count, chunk)); // first chunk on calling thread
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+}
+
+// persistent threads running chunks of parallel loops, no thread creation or allocation per loop
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned int workers = worker_count());     // includes calling thread
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    [[nodiscard]] unsigned int size() const { return static_cast<unsigned int>(threads.size()) + 1; }
+
+    // runs fn(begin, end) over contiguous chunks of [0, count), returns when all chunks are done
+    template <typename Fn>
+    void run(const size_t count, Fn &&fn)
+    {
+        using Callable = std::remove_reference_t<Fn>;
+        dispatch(count, [](void *f, const size_t begin, const size_t end) { (*static_cast<Callable *>(f))(begin, end); },
+                 const_cast<void *>(static_cast<const void *>(std::addressof(fn))));
+    }
+
+private:
+    using Job = void (*)(void *, size_t, size_t);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start;      // new loop or shutdown
+    std::condition_variable done;       // last worker finished its chunk
+
+    uint64_t generation = 0;            // number of dispatched loops
+    size_t pending = 0;                 // workers still running current loop
+    bool quit = false;
+
+    Job job = nullptr;                  // current loop
+    void *job_fn = nullptr;
+    size_t job_count = 0;
+    size_t job_chunk = 0;
+
+    void dispatch(size_t count, Job fn, void *data);
+    void work(size_t index);
+};
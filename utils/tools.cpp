@@ -4,30 +4,58 @@
 
 #include "tools.h"
 
-std::optional<int> safe_stoi(const std::string &token)
+#include <algorithm>
+#include <charconv>
+
+// sign accepted by stream input but not by from_chars
+static std::string_view skip_plus(const std::string_view token)
 {
-    try {
-        size_t pos = 0;
-        int v = std::stoi(token, &pos, 10);
-        if (pos != token.size())
-            return std::nullopt;
-        return v;
-    }
-    catch (const std::exception &) {
+    return (token.size() > 1 && token[0] == '+' && token[1] != '-') ? token.substr(1) : token;
+}
+
+std::optional<int> parse_int(std::string_view token)
+{
+    token = skip_plus(token);
+
+    int v = 0;
+    const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), v, 10);
+    if (ec != std::errc() || end != token.data() + token.size())
         return std::nullopt;
-    }
+    return v;
 }
 
-std::optional<float> safe_stof(const std::string &token)
+std::optional<float> parse_float(std::string_view token)
 {
-    try {
-        size_t pos = 0;
-        float v = std::stof(token, &pos);
-        if (pos != token.size())
-            return std::nullopt;
-        return v;
-    }
-    catch (const std::exception &) {
+    token = skip_plus(token);
+
+    float v = 0.0f;
+    const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), v);
+    if (ec != std::errc() || end != token.data() + token.size())
         return std::nullopt;
+    return v;
+}
+
+std::string_view next_line(std::string_view &text)
+{
+    const size_t eol = std::min(text.find('\n'), text.size());
+    const std::string_view line = text.substr(0, eol);
+    text.remove_prefix(std::min(eol + 1, text.size()));
+    return line;
+}
+
+std::string_view next_token(std::string_view &text)
+{
+    constexpr std::string_view separators = " \t\r";
+
+    const size_t begin = text.find_first_not_of(separators);
+    if (begin == std::string_view::npos)
+    {
+        text = {};
+        return {};
     }
-}
\ No newline at end of file
+
+    const size_t end = std::min(text.find_first_of(separators, begin), text.size());
+    const std::string_view token = text.substr(begin, end - begin);
+    text.remove_prefix(end);
+    return token;
+}
@@ -5,8 +5,14 @@
 #pragma once
 
 #include <optional>
-#include <string>
+#include <string_view>
 
-// safe operators of conversion
-std::optional<int> safe_stoi(const std::string &token);      // from string to int
-std::optional<float> safe_stof(const std::string &token);    // from string to float
\ No newline at end of file
+// exception free conversions of whole token, nullopt for malformed or out of range token
+std::optional<int> parse_int(std::string_view token);       // from string to int
+std::optional<float> parse_float(std::string_view token);   // from string to float
+
+// next line without line break, text is advanced past it
+std::string_view next_line(std::string_view &text);
+
+// next token separated by spaces, tabs or carriage returns, text is advanced past it, empty at end of text
+std::string_view next_token(std::string_view &text);